@@ -0,0 +1,1437 @@
+//
+// Configurable FastQueue / deaod SPSC benchmark
+//
+
+// Runs every combination of the queue, payload, size, batch and CPU pair lists from the command line a number of
+// warm-up and measured repetitions. Throughput mode saturates the queue and prints the median / mean / stddev / min /
+// max transactions per second. The latency modes send time stamps (TSC / CNTVCT) one way or as a ping-pong over two
+// queues, optionally paced at a fixed rate, and print the p50 / p99 / p99.9 / max latency from an HDR style histogram.
+// The results can also be written as CSV and JSON so runs on different machines and releases can be compared.
+//
+// ./fast_queue_bench --queue fastqueue,deaod --size 256,1024,4096 --batch 1,32 --cpus 3:1 --repetitions 5 --json out.json
+// ./fast_queue_bench --mode pingpong,oneway --rate 0,100000 --cpus 3:1
+// ./fast_queue_bench --mode throughput,pingpong --cpus all --matrix    (every CPU pair, labeled with its topology)
+// ./fast_queue_bench --perf --perf-raw 0x4d2    (cycles, cache misses ... per object on each side, see perf_counters.h)
+// ./fast_queue_bench --mode executor --workers 4,16,32 --cpus 0:1    (FastQueueExecutor, dispatch vs. stealing)
+// ./fast_queue_bench --queue fastqueue,fastqueue-prefetchw,fastqueue-prefetch-payload,fastqueue-warm --payload vector
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <map>
+#include <set>
+#include <sstream>
+#include <iomanip>
+#if defined _MSC_VER
+#include <intrin.h>
+#elif __x86_64__
+#include <x86intrin.h>
+#endif
+
+#include "fast_queue.h"
+#include "fast_queue_executor.h"
+#include "deaod_spsc/spsc_queue.hpp"
+#include "pin_thread.h"
+#include "perf_counters.h"
+
+#define L1_CACHE_LINE 64
+//Queue sizes are powers of two between these
+#define MIN_QUEUE_SIZE 16
+#define MAX_QUEUE_SIZE 65536
+
+class MyObject {
+public:
+    uint64_t mIndex;
+};
+
+/// -----------------------------------------------------------
+///
+/// Payloads, what is moved through the queue for object number aIndex
+///
+/// -----------------------------------------------------------
+
+//A heap allocated object per transaction, deleted by the consumer (the main.cpp pointer test)
+struct PointerPayload {
+    using Type = MyObject*;
+    static constexpr const char* NAME = "pointer";
+
+    static inline Type make(uint64_t aIndex) noexcept {
+        auto lpObject = new MyObject();
+        lpObject->mIndex = aIndex;
+        return lpObject;
+    }
+    static inline uint64_t take(Type pObject) noexcept {
+        uint64_t lIndex = pObject->mIndex;
+        delete pObject;
+        return lIndex;
+    }
+};
+
+//The 64-bit value itself, no allocation (0 is the empty slot so the value is aIndex + 1)
+struct ValuePayload {
+    using Type = uint64_t;
+    static constexpr const char* NAME = "value";
+
+    static inline Type make(uint64_t aIndex) noexcept {
+        return aIndex + 1;
+    }
+    static inline uint64_t take(Type aValue) noexcept {
+        return aValue - 1;
+    }
+};
+
+//A 1000 byte vector per transaction like FastQueueIntegrityTest.cpp, the consumer reads both ends of it so the cache
+//misses on the payload count (the --queue fastqueue-prefetch-payload case)
+struct VectorPayload {
+    using Type = std::vector<uint8_t>*;
+    static constexpr const char* NAME = "vector";
+    static constexpr uint64_t BYTES = 1000;
+
+    static inline Type make(uint64_t aIndex) noexcept {
+        auto lpData = new std::vector<uint8_t>(BYTES);
+        std::memcpy(lpData->data(), &aIndex, sizeof(aIndex));
+        lpData->back() = static_cast<uint8_t>(aIndex);
+        return lpData;
+    }
+    static inline uint64_t take(Type pData) noexcept {
+        uint64_t lIndex;
+        std::memcpy(&lIndex, pData->data(), sizeof(lIndex));
+        //A torn payload shows as an out of order index
+        if (pData->back() != static_cast<uint8_t>(lIndex)) [[unlikely]] {
+            lIndex = UINT64_MAX;
+        }
+        delete pData;
+        return lIndex;
+    }
+};
+
+//The FastQueue tunings, one --queue name each
+struct DefaultTuning {
+    static constexpr const char* NAME = "fastqueue";
+    using Traits = FastQueueArchTraits<L1_CACHE_LINE>;
+    //Each side pulls the ring into its cache (warmPush() / warmPop()) before the start
+    static constexpr bool WARM = false;
+};
+
+struct PrefetchWriteTuning : DefaultTuning {
+    static constexpr const char* NAME = "fastqueue-prefetchw";
+    using Traits = FastQueuePrefetchTraits<L1_CACHE_LINE, 4, 0>;
+};
+
+struct PrefetchPayloadTuning : DefaultTuning {
+    static constexpr const char* NAME = "fastqueue-prefetch-payload";
+    using Traits = FastQueuePrefetchTraits<L1_CACHE_LINE, 0, 4>;
+};
+
+struct WarmTuning : DefaultTuning {
+    static constexpr const char* NAME = "fastqueue-warm";
+    static constexpr bool WARM = true;
+};
+
+/// -----------------------------------------------------------
+///
+/// Queues, the same push / pop interface over FastQueue and deaod::spsc_queue
+///
+/// pop() returns the number of objects popped into pOut (at most aMax), 0 when the producer is done and the queue is empty
+///
+/// -----------------------------------------------------------
+
+template<typename Payload, uint64_t SIZE, typename Tuning = DefaultTuning>
+struct FastQueueBench {
+    using Type = typename Payload::Type;
+    static constexpr const char* NAME = Tuning::NAME;
+
+    explicit FastQueueBench(uint64_t aBatch) : mPushBuffer(aBatch), mPopBuffer(aBatch) {}
+
+    //On the producer / consumer thread before the start
+    void warmProducer() noexcept {
+        if constexpr (Tuning::WARM) {
+            mQueue.warmPush();
+        }
+    }
+    void warmConsumer() noexcept {
+        if constexpr (Tuning::WARM) {
+            mQueue.warmPop();
+        }
+    }
+
+    inline void push(uint64_t aIndex) noexcept {
+        mQueue.push(Payload::make(aIndex));
+    }
+
+    inline void pushBatch(uint64_t aFirst, uint64_t aCount) noexcept {
+        for (uint64_t i = 0; i < aCount; ++i) {
+            mPushBuffer[i] = Payload::make(aFirst + i);
+        }
+        mQueue.push_n(mPushBuffer.begin(), aCount);
+    }
+
+    inline uint64_t pop(uint64_t *pOut, uint64_t aMax) noexcept {
+        if (aMax == 1) {
+            Type lObject;
+            mQueue.pop(lObject);
+            if (!lObject) {
+                return 0;
+            }
+            *pOut = Payload::take(lObject);
+            return 1;
+        }
+        uint64_t lCount = mQueue.pop_n(mPopBuffer.begin(), aMax);
+        for (uint64_t i = 0; i < lCount; ++i) {
+            pOut[i] = Payload::take(mPopBuffer[i]);
+        }
+        return lCount;
+    }
+
+    void stop() noexcept {
+        mQueue.stopQueue();
+    }
+
+    FastQueue<Type, SIZE - 1, L1_CACHE_LINE, FastQueueWait::Spin, typename Tuning::Traits> mQueue;
+    std::vector<Type> mPushBuffer;
+    std::vector<Type> mPopBuffer;
+};
+
+template<typename Payload, uint64_t SIZE> using PrefetchWriteBench = FastQueueBench<Payload, SIZE, PrefetchWriteTuning>;
+template<typename Payload, uint64_t SIZE> using PrefetchPayloadBench = FastQueueBench<Payload, SIZE, PrefetchPayloadTuning>;
+template<typename Payload, uint64_t SIZE> using WarmBench = FastQueueBench<Payload, SIZE, WarmTuning>;
+
+template<typename Payload, uint64_t SIZE>
+struct DeaodBench {
+    using Type = typename Payload::Type;
+    static constexpr const char* NAME = "deaod";
+
+    explicit DeaodBench(uint64_t aBatch) : mPushBuffer(aBatch) {}
+
+    void warmProducer() noexcept {}
+    void warmConsumer() noexcept {}
+
+    inline void push(uint64_t aIndex) noexcept {
+        Type lObject = Payload::make(aIndex);
+        while (!mQueue.push(lObject)) {}
+    }
+
+    inline void pushBatch(uint64_t aFirst, uint64_t aCount) noexcept {
+        for (uint64_t i = 0; i < aCount; ++i) {
+            mPushBuffer[i] = Payload::make(aFirst + i);
+        }
+        auto lFirst = mPushBuffer.begin();
+        auto lEnd = lFirst + aCount;
+        while (lFirst != lEnd) {
+            lFirst += mQueue.write(lFirst, lEnd);
+        }
+    }
+
+    inline uint64_t pop(uint64_t *pOut, uint64_t aMax) noexcept {
+        while (true) {
+            //Read the flag before trying, an empty queue after the producer is done stays empty
+            bool lDone = mDone.load(std::memory_order_acquire);
+            uint64_t lCount;
+            if (aMax == 1) {
+                Type lObject;
+                lCount = mQueue.pop(lObject) ? 1 : 0;
+                if (lCount) {
+                    *pOut = Payload::take(lObject);
+                }
+            } else {
+                //Not read(), its trivially copyable path copies into the ring instead of out of it
+                lCount = 0;
+                mQueue.consume_all([&](Type *pObject) {
+                    if (lCount == aMax) {
+                        return false;
+                    }
+                    pOut[lCount++] = Payload::take(*pObject);
+                    return true;
+                });
+            }
+            if (lCount || lDone) {
+                return lCount;
+            }
+        }
+    }
+
+    void stop() noexcept {
+        mDone.store(true, std::memory_order_release);
+    }
+
+    //SIZE slots, deaod reserves one of them so it holds SIZE - 1 objects (FastQueue holds SIZE)
+    deaod::spsc_queue<Type, SIZE, 6> mQueue;
+    std::atomic<bool> mDone = false;
+    std::vector<Type> mPushBuffer;
+};
+
+//Executor mode, every worker inbox has SIZE slots (the payload does not apply)
+template<typename Payload, uint64_t SIZE>
+struct ExecutorBench {
+    using Executor = FastQueueExecutor<SIZE - 1, L1_CACHE_LINE>;
+};
+
+/// -----------------------------------------------------------
+///
+/// Time stamps and the latency histogram
+///
+/// -----------------------------------------------------------
+
+//The CPU counter, TSC on x86_64 and the virtual counter on arm64. Both tick at a constant rate and are synchronized
+//between the cores on current CPU's, so a time stamp taken on one core can be compared on another.
+inline uint64_t readTicks() noexcept {
+#if __x86_64__ || _M_X64
+    _mm_lfence();
+    return __rdtsc();
+#elif defined _MSC_VER
+    return _ReadStatusReg(ARM64_CNTVCT);
+#else
+    uint64_t lTicks;
+    asm volatile ("isb; mrs %0, cntvct_el0" : "=r" (lTicks) :: "memory");
+    return lTicks;
+#endif
+}
+
+//Measured once against steady_clock
+double nanosecondsPerTick() {
+    static const double lNanosecondsPerTick = [] {
+        auto lStart = std::chrono::steady_clock::now();
+        uint64_t lStartTicks = readTicks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        uint64_t lTicks = readTicks() - lStartTicks;
+        double lNanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - lStart).count();
+        return lNanoseconds / std::max<uint64_t>(1, lTicks);
+    }();
+    return lNanosecondsPerTick;
+}
+
+//Index of the highest bit set (aValue > 0)
+inline uint64_t highestBit(uint64_t aValue) noexcept {
+#ifdef _MSC_VER
+    unsigned long lIndex;
+    _BitScanReverse64(&lIndex, aValue);
+    return lIndex;
+#else
+    return 63 - __builtin_clzll(aValue);
+#endif
+}
+
+//HDR style histogram of nanoseconds. Values below 2^SUB_BITS are exact, above that every power of two is split in
+//2^SUB_BITS buckets so a value is reported to within 1 / 2^SUB_BITS (0.8%) and recording is a few instructions.
+class LatencyHistogram {
+public:
+    static constexpr uint64_t SUB_BITS = 7;
+    static constexpr uint64_t SUB_BUCKETS = 1ULL << SUB_BITS;
+    static constexpr uint64_t BUCKETS = SUB_BUCKETS + (64 - SUB_BITS) * SUB_BUCKETS;
+
+    LatencyHistogram() : mCounts(BUCKETS) {}
+
+    inline void record(uint64_t aValue) noexcept {
+        mCounts[index(aValue)]++;
+        mCount++;
+        mMax = std::max(mMax, aValue);
+    }
+
+    void merge(const LatencyHistogram& rOther) noexcept {
+        for (uint64_t i = 0; i < BUCKETS; ++i) {
+            mCounts[i] += rOther.mCounts[i];
+        }
+        mCount += rOther.mCount;
+        mMax = std::max(mMax, rOther.mMax);
+    }
+
+    //The highest value of the bucket holding the aPercentile (0 - 100) sample
+    uint64_t percentile(double aPercentile) const noexcept {
+        if (!mCount) {
+            return 0;
+        }
+        uint64_t lRank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(aPercentile / 100.0 * mCount)));
+        uint64_t lSeen = 0;
+        for (uint64_t i = 0; i < BUCKETS; ++i) {
+            lSeen += mCounts[i];
+            if (lSeen >= lRank) {
+                return std::min(highestValue(i), mMax);
+            }
+        }
+        return mMax;
+    }
+
+    uint64_t count() const noexcept {
+        return mCount;
+    }
+
+    uint64_t max() const noexcept {
+        return mMax;
+    }
+
+private:
+    static inline uint64_t index(uint64_t aValue) noexcept {
+        if (aValue < SUB_BUCKETS) {
+            return aValue;
+        }
+        uint64_t lShift = highestBit(aValue) - SUB_BITS;
+        return SUB_BUCKETS + lShift * SUB_BUCKETS + ((aValue >> lShift) - SUB_BUCKETS);
+    }
+
+    static inline uint64_t highestValue(uint64_t aIndex) noexcept {
+        if (aIndex < SUB_BUCKETS) {
+            return aIndex;
+        }
+        uint64_t lShift = (aIndex - SUB_BUCKETS) / SUB_BUCKETS;
+        uint64_t lMantissa = SUB_BUCKETS + (aIndex - SUB_BUCKETS) % SUB_BUCKETS;
+        return ((lMantissa + 1) << lShift) - 1;
+    }
+
+    std::vector<uint64_t> mCounts;
+    uint64_t mCount = 0;
+    uint64_t mMax = 0;
+};
+
+//Hands out the send time stamps. Paced (aRate objects/s) it spins until the next scheduled send and returns the
+//scheduled time, so a send delayed by a slow queue shows up as latency and isn't omitted. Not paced it returns now.
+class Pacer {
+public:
+    explicit Pacer(uint64_t aRate) :
+            mPeriod(aRate ? std::max<uint64_t>(1, static_cast<uint64_t>(1e9 / aRate / nanosecondsPerTick())) : 0),
+            mNext(readTicks()) {}
+
+    inline uint64_t next() noexcept {
+        if (!mPeriod) {
+            return readTicks();
+        }
+        uint64_t lScheduled = mNext;
+        while (readTicks() < lScheduled) {
+            FastQueueArchTraits<>::pause();
+        }
+        mNext += mPeriod;
+        return lScheduled;
+    }
+
+private:
+    const uint64_t mPeriod;
+    uint64_t mNext;
+};
+
+/// -----------------------------------------------------------
+///
+/// One run
+///
+/// -----------------------------------------------------------
+
+struct RunParams {
+    uint64_t mBatch = 1;
+    int32_t mProducerCpu = 3;
+    int32_t mConsumerCpu = 1;
+    uint64_t mDurationMs = 2000;
+    //Objects per second sent in the latency modes, 0 is as fast as possible
+    uint64_t mRate = 0;
+    //Count the hardware events of the producer and consumer loops in throughput mode, mPerfRaw is a raw event or 0
+    bool mPerf = false;
+    uint64_t mPerfRaw = 0;
+    //Executor mode, the workers run on the CPU's from mConsumerCpu up
+    uint64_t mWorkers = 4;
+};
+
+struct RunResult {
+    uint64_t mObjects = 0;
+    double mSeconds = 0;
+    uint64_t mErrors = 0;
+    bool mPinFailed = false;
+    PerfCounterValues mProducerPerf;
+    PerfCounterValues mConsumerPerf;
+    //Executor mode, of the mObjects tasks run this many were stolen from another worker
+    uint64_t mStolen = 0;
+};
+
+struct LatencyResult {
+    LatencyHistogram mHistogram;
+    bool mPinFailed = false;
+};
+
+//Shared by the producer, the consumer and the thread running the benchmark
+struct RunState {
+    std::atomic<bool> mStart = false;
+    std::atomic<bool> mActive = true;
+    std::atomic<bool> mPinFailed = false;
+    bool mPerf = false;
+    uint64_t mPerfRaw = 0;
+    //Written by the producer / consumer before it exits, read after the join
+    uint64_t mObjects = 0;
+    uint64_t mErrors = 0;
+    std::chrono::steady_clock::time_point mEnd;
+    PerfCounterValues mProducerPerf;
+    PerfCounterValues mConsumerPerf;
+};
+
+void pinBenchThread(RunState *pState, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU " << aCPU << " fail. " << std::endl;
+        pState->mPinFailed = true;
+    }
+}
+
+void waitForStart(RunState *pState) {
+    while (!pState->mStart.load(std::memory_order_acquire)) {
+        FastQueueArchTraits<>::pause();
+    }
+}
+
+//Nanoseconds from the time stamp aStamp to now
+inline uint64_t latencySince(uint64_t aStamp, double aNanosecondsPerTick) noexcept {
+    uint64_t lNow = readTicks();
+    return lNow > aStamp ? static_cast<uint64_t>((lNow - aStamp) * aNanosecondsPerTick) : 0;
+}
+
+//The counters of the calling thread when RunState::mPerf is set, nullptr if not
+std::unique_ptr<PerfCounters> benchPerfCounters(RunState *pState) {
+    return pState->mPerf ? std::make_unique<PerfCounters>(pState->mPerfRaw) : nullptr;
+}
+
+template<typename Queue>
+void benchProducer(Queue *pQueue, RunState *pState, int32_t aCPU, uint64_t aBatch) {
+    pinBenchThread(pState, aCPU);
+    auto lpPerf = benchPerfCounters(pState);
+    pQueue->warmProducer();
+    waitForStart(pState);
+    if (lpPerf) {
+        lpPerf->start();
+    }
+    uint64_t lIndex = 0;
+    if (aBatch == 1) {
+        while (pState->mActive.load(std::memory_order_relaxed)) {
+            pQueue->push(lIndex++);
+        }
+    } else {
+        while (pState->mActive.load(std::memory_order_relaxed)) {
+            pQueue->pushBatch(lIndex, aBatch);
+            lIndex += aBatch;
+        }
+    }
+    if (lpPerf) {
+        lpPerf->stop();
+        pState->mProducerPerf = lpPerf->read();
+    }
+    pQueue->stop();
+}
+
+template<typename Queue>
+void benchConsumer(Queue *pQueue, RunState *pState, int32_t aCPU, uint64_t aBatch) {
+    pinBenchThread(pState, aCPU);
+    std::vector<uint64_t> lIndexes(aBatch);
+    uint64_t lExpected = 0;
+    uint64_t lErrors = 0;
+    auto lpPerf = benchPerfCounters(pState);
+    pQueue->warmConsumer();
+    waitForStart(pState);
+    if (lpPerf) {
+        lpPerf->start();
+    }
+    while (uint64_t lCount = pQueue->pop(lIndexes.data(), aBatch)) {
+        for (uint64_t i = 0; i < lCount; ++i) {
+            if (lIndexes[i] != lExpected) [[unlikely]] {
+                lErrors++;
+            }
+            lExpected = lIndexes[i] + 1;
+        }
+    }
+    if (lpPerf) {
+        lpPerf->stop();
+        pState->mConsumerPerf = lpPerf->read();
+    }
+    pState->mObjects = lExpected;
+    pState->mErrors = lErrors;
+    pState->mEnd = std::chrono::steady_clock::now();
+}
+
+//One-way latency, the producer sends its time stamp and the consumer compares it to its own clock
+template<typename Queue>
+void oneWayProducer(Queue *pQueue, RunState *pState, int32_t aCPU, uint64_t aRate) {
+    pinBenchThread(pState, aCPU);
+    waitForStart(pState);
+    Pacer lPacer(aRate);
+    while (pState->mActive.load(std::memory_order_relaxed)) {
+        pQueue->push(lPacer.next());
+    }
+    pQueue->stop();
+}
+
+template<typename Queue>
+void oneWayConsumer(Queue *pQueue, RunState *pState, int32_t aCPU, LatencyHistogram *pHistogram) {
+    pinBenchThread(pState, aCPU);
+    const double lNanosecondsPerTick = nanosecondsPerTick();
+    uint64_t lStamp;
+    while (pQueue->pop(&lStamp, 1)) {
+        pHistogram->record(latencySince(lStamp, lNanosecondsPerTick));
+    }
+}
+
+//Round trip latency, the sender waits for the echo of every object before it sends the next one
+template<typename Queue>
+void pingPongSender(Queue *pPing, Queue *pPong, RunState *pState, int32_t aCPU, uint64_t aRate, LatencyHistogram *pHistogram) {
+    pinBenchThread(pState, aCPU);
+    waitForStart(pState);
+    const double lNanosecondsPerTick = nanosecondsPerTick();
+    Pacer lPacer(aRate);
+    uint64_t lEcho;
+    while (pState->mActive.load(std::memory_order_relaxed)) {
+        uint64_t lStamp = lPacer.next();
+        pPing->push(lStamp);
+        if (!pPong->pop(&lEcho, 1)) {
+            break;
+        }
+        pHistogram->record(latencySince(lStamp, lNanosecondsPerTick));
+    }
+    pPing->stop();
+    while (pPong->pop(&lEcho, 1)) {}
+}
+
+template<typename Queue>
+void pingPongEcho(Queue *pPing, Queue *pPong, RunState *pState, int32_t aCPU) {
+    pinBenchThread(pState, aCPU);
+    uint64_t lStamp;
+    while (pPing->pop(&lStamp, 1)) {
+        pPong->push(lStamp);
+    }
+    pPong->stop();
+}
+
+//Start the threads, let them run for aDurationMs and join them. Returns the start time.
+std::chrono::steady_clock::time_point runFor(RunState& rState, std::thread& rProducer, std::thread& rConsumer, uint64_t aDurationMs) {
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    auto lStart = std::chrono::steady_clock::now();
+    rState.mStart.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(aDurationMs));
+    rState.mActive = false;
+    rProducer.join();
+    rConsumer.join();
+    return lStart;
+}
+
+template<typename Queue>
+RunResult runThroughput(const RunParams& rParams) {
+    auto lpQueue = std::make_unique<Queue>(rParams.mBatch);
+    RunState lState;
+    lState.mPerf = rParams.mPerf;
+    lState.mPerfRaw = rParams.mPerfRaw;
+    std::thread lConsumer(benchConsumer<Queue>, lpQueue.get(), &lState, rParams.mConsumerCpu, rParams.mBatch);
+    std::thread lProducer(benchProducer<Queue>, lpQueue.get(), &lState, rParams.mProducerCpu, rParams.mBatch);
+    auto lStart = runFor(lState, lProducer, lConsumer, rParams.mDurationMs);
+
+    RunResult lResult;
+    lResult.mObjects = lState.mObjects;
+    lResult.mSeconds = std::chrono::duration<double>(lState.mEnd - lStart).count();
+    lResult.mErrors = lState.mErrors;
+    lResult.mPinFailed = lState.mPinFailed;
+    lResult.mProducerPerf = lState.mProducerPerf;
+    lResult.mConsumerPerf = lState.mConsumerPerf;
+    return lResult;
+}
+
+template<typename Queue>
+LatencyResult runLatency(const RunParams& rParams, bool aPingPong) {
+    //The ping queue carries the time stamps producer -> consumer, the pong queue echoes them back
+    auto lpPing = std::make_unique<Queue>(1);
+    auto lpPong = std::make_unique<Queue>(1);
+    RunState lState;
+    LatencyResult lResult;
+    nanosecondsPerTick();
+    std::thread lConsumer;
+    std::thread lProducer;
+    if (aPingPong) {
+        lConsumer = std::thread(pingPongEcho<Queue>, lpPing.get(), lpPong.get(), &lState, rParams.mConsumerCpu);
+        lProducer = std::thread(pingPongSender<Queue>, lpPing.get(), lpPong.get(), &lState, rParams.mProducerCpu, rParams.mRate, &lResult.mHistogram);
+    } else {
+        lConsumer = std::thread(oneWayConsumer<Queue>, lpPing.get(), &lState, rParams.mConsumerCpu, &lResult.mHistogram);
+        lProducer = std::thread(oneWayProducer<Queue>, lpPing.get(), &lState, rParams.mProducerCpu, rParams.mRate);
+    }
+    runFor(lState, lProducer, lConsumer, rParams.mDurationMs);
+    lResult.mPinFailed = lState.mPinFailed;
+    return lResult;
+}
+
+//Executor mode task length. 1 in 8 tasks (at random) is EXECUTOR_HEAVY_TASK times longer, so a round robin dispatch
+//leaves a backlog on some workers while others have nothing to do.
+#define EXECUTOR_TASK_ROUNDS 256
+#define EXECUTOR_HEAVY_TASK 64
+
+thread_local uint64_t tTaskResult = 0;
+
+inline void executorTask(uint64_t aRounds) noexcept {
+    uint64_t lValue = tTaskResult;
+    for (uint64_t i = 0; i < aRounds; ++i) {
+        lValue = lValue * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    tTaskResult = lValue;
+}
+
+//The dispatcher (on the producer CPU) submits tasks as fast as the executor takes them, mObjects is the number of
+//tasks run when the time is up. The tasks still queued then are run by shutdown() and not counted.
+template<typename Executor>
+RunResult runExecutor(const RunParams& rParams, bool aStealing) {
+    std::vector<int32_t> lCpus;
+    for (uint64_t i = 0; i < rParams.mWorkers; ++i) {
+        lCpus.push_back(rParams.mConsumerCpu + static_cast<int32_t>(i));
+    }
+    auto lpExecutor = std::make_unique<Executor>(lCpus, aStealing);
+    RunState lState;
+    RunResult lResult;
+    std::thread lDispatcher([&] {
+        pinBenchThread(&lState, rParams.mProducerCpu);
+        waitForStart(&lState);
+        uint64_t lRandom = 1;
+        while (lState.mActive.load(std::memory_order_relaxed)) {
+            //xorshift64
+            lRandom ^= lRandom << 13;
+            lRandom ^= lRandom >> 7;
+            lRandom ^= lRandom << 17;
+            uint64_t lRounds = lRandom % 8 ? EXECUTOR_TASK_ROUNDS : EXECUTOR_TASK_ROUNDS * EXECUTOR_HEAVY_TASK;
+            lpExecutor->submit([lRounds] { executorTask(lRounds); });
+        }
+        lResult.mObjects = lpExecutor->executed();
+        lResult.mStolen = lpExecutor->stolen();
+        lState.mEnd = std::chrono::steady_clock::now();
+    });
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto lStart = std::chrono::steady_clock::now();
+    lState.mStart.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(rParams.mDurationMs));
+    lState.mActive = false;
+    lDispatcher.join();
+    lpExecutor->shutdown();
+    lResult.mSeconds = std::chrono::duration<double>(lState.mEnd - lStart).count();
+    lResult.mPinFailed = lState.mPinFailed || lpExecutor->pinFailed();
+    return lResult;
+}
+
+struct ThroughputRunner {
+    using Result = RunResult;
+    template<typename Queue>
+    RunResult run() const {
+        return runThroughput<Queue>(mParams);
+    }
+    const RunParams& mParams;
+};
+
+struct LatencyRunner {
+    using Result = LatencyResult;
+    template<typename Queue>
+    LatencyResult run() const {
+        return runLatency<Queue>(mParams, mPingPong);
+    }
+    const RunParams& mParams;
+    bool mPingPong;
+};
+
+struct ExecutorRunner {
+    using Result = RunResult;
+    template<typename Queue>
+    RunResult run() const {
+        return runExecutor<typename Queue::Executor>(mParams, mStealing);
+    }
+    const RunParams& mParams;
+    bool mStealing;
+};
+
+//Map the runtime queue, payload and size to the queue instantiated for them
+template<typename Runner, template<typename, uint64_t> class Queue, typename Payload, uint64_t SIZE = MIN_QUEUE_SIZE>
+typename Runner::Result runSize(uint64_t aSize, const Runner& rRunner) {
+    if constexpr (SIZE > MAX_QUEUE_SIZE) {
+        return {};
+    } else {
+        if (aSize == SIZE) {
+            return rRunner.template run<Queue<Payload, SIZE>>();
+        }
+        return runSize<Runner, Queue, Payload, SIZE * 2>(aSize, rRunner);
+    }
+}
+
+template<typename Runner, typename Payload>
+typename Runner::Result runPayload(const std::string& rQueue, uint64_t aSize, const Runner& rRunner) {
+    if (rQueue == FastQueueBench<Payload, MIN_QUEUE_SIZE>::NAME) {
+        return runSize<Runner, FastQueueBench, Payload>(aSize, rRunner);
+    }
+    if (rQueue == PrefetchWriteTuning::NAME) {
+        return runSize<Runner, PrefetchWriteBench, Payload>(aSize, rRunner);
+    }
+    if (rQueue == PrefetchPayloadTuning::NAME) {
+        return runSize<Runner, PrefetchPayloadBench, Payload>(aSize, rRunner);
+    }
+    if (rQueue == WarmTuning::NAME) {
+        return runSize<Runner, WarmBench, Payload>(aSize, rRunner);
+    }
+    return runSize<Runner, DeaodBench, Payload>(aSize, rRunner);
+}
+
+template<typename Runner>
+typename Runner::Result run(const std::string& rQueue, const std::string& rPayload, uint64_t aSize, const Runner& rRunner) {
+    if (rPayload == PointerPayload::NAME) {
+        return runPayload<Runner, PointerPayload>(rQueue, aSize, rRunner);
+    }
+    if (rPayload == VectorPayload::NAME) {
+        return runPayload<Runner, VectorPayload>(rQueue, aSize, rRunner);
+    }
+    return runPayload<Runner, ValuePayload>(rQueue, aSize, rRunner);
+}
+
+/// -----------------------------------------------------------
+///
+/// Sweep, statistics and output
+///
+/// -----------------------------------------------------------
+
+//throughput saturates the queue, oneway / pingpong measure the latency of single objects, executor compares a
+//dispatcher to worker pool with FastQueueExecutor's work stealing
+static const char* const MODES[] = {"throughput", "oneway", "pingpong", "executor"};
+//--queue names, the FastQueue tunings and the deaod reference
+static const char* const QUEUES[] = {DefaultTuning::NAME, PrefetchWriteTuning::NAME, PrefetchPayloadTuning::NAME, WarmTuning::NAME, "deaod"};
+//The "queues" of the executor mode, stealing off / on
+static const char* const EXECUTORS[] = {"dispatch", "stealing"};
+
+struct BenchConfig {
+    std::vector<std::string> mModes = {"throughput"};
+    std::vector<std::string> mQueues = {"fastqueue", "deaod"};
+    std::vector<std::string> mPayloads = {"pointer"};
+    std::vector<uint64_t> mSizes = {1024};
+    std::vector<uint64_t> mBatches = {1};
+    //Producer CPU, consumer CPU
+    std::vector<std::pair<int32_t, int32_t>> mCpus = {{3, 1}};
+    std::vector<uint64_t> mRates = {0};
+    std::vector<uint64_t> mWorkers = {4};
+    //Print a producer x consumer matrix of every result group
+    bool mMatrix = false;
+    bool mPerf = false;
+    uint64_t mPerfRaw = 0;
+    uint64_t mDurationMs = 2000;
+    uint64_t mWarmups = 1;
+    uint64_t mRepetitions = 5;
+    std::string mCsvFile;
+    std::string mJsonFile;
+};
+
+struct BenchResult {
+    std::string mMode;
+    std::string mQueue;
+    std::string mPayload;
+    uint64_t mSize = 0;
+    uint64_t mBatch = 1;
+    int32_t mProducerCpu = 0;
+    int32_t mConsumerCpu = 0;
+    //cpuRelationName() of the CPU pair
+    std::string mRelation;
+    uint64_t mRate = 0;
+    uint64_t mRuns = 0;
+    uint64_t mErrors = 0;
+    //Throughput, transactions per second of every measured repetition
+    std::vector<double> mSamples;
+    double mMedian = 0;
+    double mMean = 0;
+    double mStddev = 0;
+    double mMin = 0;
+    double mMax = 0;
+    //Latency in nanoseconds over all measured repetitions
+    uint64_t mLatencySamples = 0;
+    uint64_t mP50 = 0;
+    uint64_t mP99 = 0;
+    uint64_t mP999 = 0;
+    uint64_t mLatencyMax = 0;
+    //Hardware events per object over all measured repetitions (throughput, --perf), not valid if not counted
+    PerfCounterValues mProducerPerf;
+    PerfCounterValues mConsumerPerf;
+    uint64_t mPerfObjects = 0;
+    //Executor mode, tasks run / stolen over all measured repetitions
+    uint64_t mWorkers = 0;
+    uint64_t mTasks = 0;
+    uint64_t mStolen = 0;
+
+    bool isThroughput() const noexcept {
+        return mMode == MODES[0];
+    }
+    bool isExecutor() const noexcept {
+        return mMode == MODES[3];
+    }
+    //Rate samples (throughput and executor) and not latency
+    bool hasSamples() const noexcept {
+        return isThroughput() || isExecutor();
+    }
+    double stolenPercent() const noexcept {
+        return mTasks ? 100.0 * mStolen / mTasks : 0;
+    }
+};
+
+void computeStatistics(BenchResult& rResult) {
+    std::vector<double> lSorted = rResult.mSamples;
+    std::sort(lSorted.begin(), lSorted.end());
+    uint64_t lCount = lSorted.size();
+    if (!lCount) {
+        return;
+    }
+    rResult.mMedian = lCount % 2 ? lSorted[lCount / 2] : (lSorted[lCount / 2 - 1] + lSorted[lCount / 2]) / 2;
+    double lSum = 0;
+    for (double lSample: lSorted) {
+        lSum += lSample;
+    }
+    rResult.mMean = lSum / lCount;
+    double lSquares = 0;
+    for (double lSample: lSorted) {
+        lSquares += (lSample - rResult.mMean) * (lSample - rResult.mMean);
+    }
+    //Sample standard deviation
+    rResult.mStddev = lCount > 1 ? std::sqrt(lSquares / (lCount - 1)) : 0;
+    rResult.mMin = lSorted.front();
+    rResult.mMax = lSorted.back();
+}
+
+//Every combination of the lists, the batch sizes only apply to throughput, the rates only to latency and the worker
+//counts only to the executor (which runs dispatch and stealing instead of the queues)
+std::vector<BenchResult> expandCases(const BenchConfig& rConfig) {
+    std::vector<BenchResult> lCases;
+    for (const auto& rMode: rConfig.mModes) {
+        bool lThroughput = rMode == MODES[0];
+        bool lExecutor = rMode == MODES[3];
+        std::vector<std::string> lQueues = lExecutor ? std::vector<std::string>(std::begin(EXECUTORS), std::end(EXECUTORS)) : rConfig.mQueues;
+        std::vector<std::string> lPayloads = lExecutor ? std::vector<std::string>{"task"} : rConfig.mPayloads;
+        std::vector<uint64_t> lBatches = lThroughput ? rConfig.mBatches : std::vector<uint64_t>{1};
+        std::vector<uint64_t> lRates = lThroughput || lExecutor ? std::vector<uint64_t>{0} : rConfig.mRates;
+        std::vector<uint64_t> lWorkers = lExecutor ? rConfig.mWorkers : std::vector<uint64_t>{0};
+        for (const auto& rQueue: lQueues) {
+            for (const auto& rPayload: lPayloads) {
+                for (uint64_t lSize: rConfig.mSizes) {
+                    for (uint64_t lBatch: lBatches) {
+                        for (const auto& rCpus: rConfig.mCpus) {
+                            for (uint64_t lRate: lRates) for (uint64_t lWorkerCount: lWorkers) {
+                                BenchResult lCase;
+                                lCase.mMode = rMode;
+                                lCase.mQueue = rQueue;
+                                lCase.mPayload = rPayload;
+                                lCase.mSize = lSize;
+                                lCase.mBatch = lBatch;
+                                lCase.mProducerCpu = rCpus.first;
+                                lCase.mConsumerCpu = rCpus.second;
+                                lCase.mRelation = cpuRelationName(cpuRelation(rCpus.first, rCpus.second));
+                                lCase.mRate = lRate;
+                                lCase.mWorkers = lWorkerCount;
+                                lCases.push_back(lCase);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return lCases;
+}
+
+void addPerfCounters(PerfCounterValues& rSum, const PerfCounterValues& rRun) {
+    for (uint64_t i = 0; i < PERF_COUNTERS; ++i) {
+        rSum.mValues[i] += rRun.mValues[i];
+        rSum.mValid[i] = rSum.mValid[i] && rRun.mValid[i];
+    }
+}
+
+//Events per object, a negative value if the counter is not valid
+double perfPerObject(const BenchResult& rResult, const PerfCounterValues& rValues, uint64_t aCounter) {
+    if (!rValues.mValid[aCounter] || !rResult.mPerfObjects) {
+        return -1;
+    }
+    return static_cast<double>(rValues.mValues[aCounter]) / rResult.mPerfObjects;
+}
+
+//Run the warm-up and measured repetitions of rCase. Returns false if a thread could not be pinned or objects were lost.
+bool runCase(const BenchConfig& rConfig, BenchResult& rCase) {
+    RunParams lParams;
+    lParams.mBatch = rCase.mBatch;
+    lParams.mProducerCpu = rCase.mProducerCpu;
+    lParams.mConsumerCpu = rCase.mConsumerCpu;
+    lParams.mDurationMs = rConfig.mDurationMs;
+    lParams.mRate = rCase.mRate;
+    lParams.mPerf = rConfig.mPerf;
+    lParams.mPerfRaw = rConfig.mPerfRaw;
+    lParams.mWorkers = rCase.mWorkers;
+    bool lOk = true;
+    //A counter is valid if it was counted in every measured run
+    rCase.mProducerPerf.mValid.fill(rConfig.mPerf);
+    rCase.mConsumerPerf.mValid.fill(rConfig.mPerf);
+    LatencyHistogram lHistogram;
+    for (uint64_t lRun = 0; lRun < rConfig.mWarmups + rConfig.mRepetitions; ++lRun) {
+        bool lMeasured = lRun >= rConfig.mWarmups;
+        if (rCase.hasSamples()) {
+            RunResult lResult = rCase.isExecutor() ?
+                    runSize<ExecutorRunner, ExecutorBench, ValuePayload>(rCase.mSize, ExecutorRunner{lParams, rCase.mQueue == EXECUTORS[1]}) :
+                    run(rCase.mQueue, rCase.mPayload, rCase.mSize, ThroughputRunner{lParams});
+            lOk &= !lResult.mPinFailed;
+            rCase.mErrors += lResult.mErrors;
+            if (lMeasured) {
+                rCase.mSamples.push_back(lResult.mObjects / lResult.mSeconds);
+                addPerfCounters(rCase.mProducerPerf, lResult.mProducerPerf);
+                addPerfCounters(rCase.mConsumerPerf, lResult.mConsumerPerf);
+                rCase.mPerfObjects += rConfig.mPerf ? lResult.mObjects : 0;
+                rCase.mTasks += rCase.isExecutor() ? lResult.mObjects : 0;
+                rCase.mStolen += lResult.mStolen;
+            }
+        } else {
+            LatencyResult lResult = run(rCase.mQueue, rCase.mPayload, rCase.mSize, LatencyRunner{lParams, rCase.mMode == MODES[2]});
+            lOk &= !lResult.mPinFailed;
+            if (lMeasured) {
+                lHistogram.merge(lResult.mHistogram);
+            }
+        }
+        rCase.mRuns += lMeasured;
+    }
+    computeStatistics(rCase);
+    rCase.mLatencySamples = lHistogram.count();
+    rCase.mP50 = lHistogram.percentile(50.0);
+    rCase.mP99 = lHistogram.percentile(99.0);
+    rCase.mP999 = lHistogram.percentile(99.9);
+    rCase.mLatencyMax = lHistogram.max();
+    return lOk && !rCase.mErrors;
+}
+
+void printResult(const BenchResult& rResult) {
+    std::cout << rResult.mMode << " " << rResult.mQueue << " " << rResult.mPayload << " size " << rResult.mSize;
+    if (rResult.isExecutor()) {
+        std::cout << " workers " << rResult.mWorkers;
+    } else if (rResult.isThroughput()) {
+        std::cout << " batch " << rResult.mBatch;
+    } else {
+        std::cout << " rate " << (rResult.mRate ? std::to_string(rResult.mRate) + "/s" : "max");
+    }
+    std::cout << " cpus " << rResult.mProducerCpu << ":" << rResult.mConsumerCpu << " (" << rResult.mRelation << ")";
+    if (rResult.hasSamples()) {
+        std::cout << " -> median " << uint64_t(rResult.mMedian) << "/s stddev " << uint64_t(rResult.mStddev)
+                  << " (min " << uint64_t(rResult.mMin) << " max " << uint64_t(rResult.mMax)
+                  << ", " << rResult.mRuns << " runs)";
+        if (rResult.isExecutor()) {
+            std::cout << " stolen " << std::fixed << std::setprecision(1) << rResult.stolenPercent() << "%" << std::defaultfloat;
+        }
+    } else {
+        std::cout << " -> p50 " << rResult.mP50 << "ns p99 " << rResult.mP99 << "ns p99.9 " << rResult.mP999
+                  << "ns max " << rResult.mLatencyMax << "ns (" << rResult.mLatencySamples << " samples, "
+                  << rResult.mRuns << " runs)";
+    }
+    std::cout << (rResult.mErrors ? " QUEUE ITEM ERRORS" : "") << std::endl;
+    if (!rResult.isThroughput() || !rResult.mPerfObjects) {
+        return;
+    }
+    const char* const lSides[] = {"producer", "consumer"};
+    const PerfCounterValues* const lValues[] = {&rResult.mProducerPerf, &rResult.mConsumerPerf};
+    for (uint64_t lSide = 0; lSide < 2; ++lSide) {
+        std::cout << "    " << lSides[lSide] << " per object:";
+        bool lAny = false;
+        for (uint64_t i = 0; i < PERF_COUNTERS; ++i) {
+            double lPerObject = perfPerObject(rResult, *lValues[lSide], i);
+            if (lPerObject >= 0) {
+                std::cout << " " << PERF_COUNTER_NAMES[i] << " " << std::fixed << std::setprecision(3) << lPerObject;
+                lAny = true;
+            }
+        }
+        std::cout << std::defaultfloat << (lAny ? "" : " no counters available") << std::endl;
+    }
+}
+
+//Columns that don't apply to the mode are left empty
+void writeCsv(std::ostream& rOut, const std::vector<BenchResult>& rResults) {
+    rOut << "mode,queue,payload,size,batch,producer_cpu,consumer_cpu,relation,rate,repetitions,median,mean,stddev,min,max,errors,"
+            "samples,p50_ns,p99_ns,p999_ns,max_ns";
+    for (const char* pSide: {"producer", "consumer"}) {
+        for (const char* pCounter: PERF_COUNTER_NAMES) {
+            rOut << "," << pSide << "_" << pCounter;
+        }
+    }
+    rOut << ",workers,stolen_percent" << std::endl;
+    for (const auto& rResult: rResults) {
+        rOut << rResult.mMode << "," << rResult.mQueue << "," << rResult.mPayload << "," << rResult.mSize << ","
+             << rResult.mBatch << "," << rResult.mProducerCpu << "," << rResult.mConsumerCpu << "," << rResult.mRelation << ","
+             << rResult.mRate << ","
+             << rResult.mRuns << ",";
+        if (rResult.hasSamples()) {
+            rOut << uint64_t(rResult.mMedian) << "," << uint64_t(rResult.mMean) << "," << uint64_t(rResult.mStddev) << ","
+                 << uint64_t(rResult.mMin) << "," << uint64_t(rResult.mMax) << "," << rResult.mErrors << ",,,,,";
+        } else {
+            rOut << ",,,,,," << rResult.mLatencySamples << "," << rResult.mP50 << "," << rResult.mP99 << ","
+                 << rResult.mP999 << "," << rResult.mLatencyMax;
+        }
+        //Events per object
+        for (const PerfCounterValues* pValues: {&rResult.mProducerPerf, &rResult.mConsumerPerf}) {
+            for (uint64_t i = 0; i < PERF_COUNTERS; ++i) {
+                double lPerObject = perfPerObject(rResult, *pValues, i);
+                rOut << ",";
+                if (lPerObject >= 0) {
+                    rOut << lPerObject;
+                }
+            }
+        }
+        if (rResult.isExecutor()) {
+            rOut << "," << rResult.mWorkers << "," << rResult.stolenPercent();
+        } else {
+            rOut << ",,";
+        }
+        rOut << std::endl;
+    }
+}
+
+void writeJson(std::ostream& rOut, const BenchConfig& rConfig, const std::vector<BenchResult>& rResults) {
+    rOut << "{" << std::endl;
+    rOut << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << "," << std::endl;
+    rOut << "  \"duration_ms\": " << rConfig.mDurationMs << "," << std::endl;
+    rOut << "  \"warmups\": " << rConfig.mWarmups << "," << std::endl;
+    rOut << "  \"repetitions\": " << rConfig.mRepetitions << "," << std::endl;
+    rOut << "  \"results\": [" << std::endl;
+    for (uint64_t i = 0; i < rResults.size(); ++i) {
+        const auto& rResult = rResults[i];
+        rOut << "    {\"mode\": \"" << rResult.mMode << "\", \"queue\": \"" << rResult.mQueue
+             << "\", \"payload\": \"" << rResult.mPayload << "\", \"size\": " << rResult.mSize
+             << ", \"producer_cpu\": " << rResult.mProducerCpu << ", \"consumer_cpu\": " << rResult.mConsumerCpu
+             << ", \"relation\": \"" << rResult.mRelation << "\"";
+        if (rResult.hasSamples()) {
+            if (rResult.isExecutor()) {
+                rOut << ", \"workers\": " << rResult.mWorkers << ", \"stolen_percent\": " << rResult.stolenPercent();
+            }
+            rOut << ", \"batch\": " << rResult.mBatch << ", \"median\": " << uint64_t(rResult.mMedian)
+                 << ", \"mean\": " << uint64_t(rResult.mMean) << ", \"stddev\": " << uint64_t(rResult.mStddev)
+                 << ", \"min\": " << uint64_t(rResult.mMin) << ", \"max\": " << uint64_t(rResult.mMax)
+                 << ", \"errors\": " << rResult.mErrors << ", \"samples\": [";
+            for (uint64_t j = 0; j < rResult.mSamples.size(); ++j) {
+                rOut << (j ? ", " : "") << uint64_t(rResult.mSamples[j]);
+            }
+            rOut << "]";
+            if (rResult.isThroughput() && rResult.mPerfObjects) {
+                //Events per object, counters not available are left out
+                rOut << ", \"perf_per_object\": {";
+                const char* const lSides[] = {"producer", "consumer"};
+                const PerfCounterValues* const lValues[] = {&rResult.mProducerPerf, &rResult.mConsumerPerf};
+                for (uint64_t lSide = 0; lSide < 2; ++lSide) {
+                    rOut << (lSide ? ", " : "") << "\"" << lSides[lSide] << "\": {";
+                    bool lFirst = true;
+                    for (uint64_t j = 0; j < PERF_COUNTERS; ++j) {
+                        double lPerObject = perfPerObject(rResult, *lValues[lSide], j);
+                        if (lPerObject >= 0) {
+                            rOut << (lFirst ? "" : ", ") << "\"" << PERF_COUNTER_NAMES[j] << "\": " << lPerObject;
+                            lFirst = false;
+                        }
+                    }
+                    rOut << "}";
+                }
+                rOut << "}";
+            }
+            rOut << "}";
+        } else {
+            rOut << ", \"rate\": " << rResult.mRate << ", \"repetitions\": " << rResult.mRuns
+                 << ", \"samples\": " << rResult.mLatencySamples << ", \"p50_ns\": " << rResult.mP50
+                 << ", \"p99_ns\": " << rResult.mP99 << ", \"p999_ns\": " << rResult.mP999
+                 << ", \"max_ns\": " << rResult.mLatencyMax << "}";
+        }
+        rOut << (i + 1 < rResults.size() ? "," : "") << std::endl;
+    }
+    rOut << "  ]" << std::endl;
+    rOut << "}" << std::endl;
+}
+
+//One producer (rows) x consumer (columns) matrix for every group of results that only differ in the CPU pair.
+//Throughput (executor) cells are the median in millions of transactions (tasks) per second, latency cells the
+//p50 / p99 in nanoseconds.
+void printMatrices(const std::vector<BenchResult>& rResults) {
+    std::vector<std::string> lGroups;
+    std::map<std::string, std::vector<const BenchResult*>> lGroupResults;
+    for (const auto& rResult: rResults) {
+        std::ostringstream lKey;
+        lKey << rResult.mMode << " " << rResult.mQueue << " " << rResult.mPayload << " size " << rResult.mSize;
+        if (rResult.isExecutor()) {
+            lKey << " workers " << rResult.mWorkers << " (median M/s)";
+        } else if (rResult.isThroughput()) {
+            lKey << " batch " << rResult.mBatch << " (median M/s)";
+        } else {
+            lKey << " rate " << (rResult.mRate ? std::to_string(rResult.mRate) + "/s" : "max") << " (p50/p99 ns)";
+        }
+        if (!lGroupResults.count(lKey.str())) {
+            lGroups.push_back(lKey.str());
+        }
+        lGroupResults[lKey.str()].push_back(&rResult);
+    }
+    constexpr int CELL_WIDTH = 16;
+    for (const auto& rGroup: lGroups) {
+        std::set<int32_t> lProducers;
+        std::set<int32_t> lConsumers;
+        std::map<std::pair<int32_t, int32_t>, std::string> lCells;
+        for (const BenchResult* pResult: lGroupResults[rGroup]) {
+            lProducers.insert(pResult->mProducerCpu);
+            lConsumers.insert(pResult->mConsumerCpu);
+            std::ostringstream lCell;
+            if (pResult->hasSamples()) {
+                lCell << std::fixed << std::setprecision(2) << pResult->mMedian / 1e6;
+            } else {
+                lCell << pResult->mP50 << "/" << pResult->mP99;
+            }
+            lCells[{pResult->mProducerCpu, pResult->mConsumerCpu}] = lCell.str();
+        }
+        std::cout << std::endl << rGroup << std::endl << std::setw(CELL_WIDTH) << "prod \\ cons";
+        for (int32_t lConsumer: lConsumers) {
+            std::cout << " " << std::setw(CELL_WIDTH) << lConsumer;
+        }
+        std::cout << std::endl;
+        for (int32_t lProducer: lProducers) {
+            std::cout << std::setw(CELL_WIDTH) << lProducer;
+            for (int32_t lConsumer: lConsumers) {
+                auto lCell = lCells.find({lProducer, lConsumer});
+                std::cout << " " << std::setw(CELL_WIDTH) << (lCell == lCells.end() ? "-" : lCell->second);
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+//Write to aFile, - is stdout
+template<typename Writer>
+bool writeOutput(const std::string& rFile, Writer&& aWriter) {
+    if (rFile == "-") {
+        aWriter(std::cout);
+        return true;
+    }
+    std::ofstream lFile(rFile);
+    if (!lFile) {
+        std::cout << "Can't open " << rFile << std::endl;
+        return false;
+    }
+    aWriter(lFile);
+    return true;
+}
+
+/// -----------------------------------------------------------
+///
+/// Command line
+///
+/// -----------------------------------------------------------
+
+void printUsage() {
+    std::cout << "Usage: fast_queue_bench [options], lists are comma separated and every combination is run" << std::endl
+              << "  --mode LIST          throughput, oneway, pingpong, executor (default throughput)" << std::endl
+              << "  --queue LIST         fastqueue, fastqueue-prefetchw, fastqueue-prefetch-payload, fastqueue-warm, deaod" << std::endl
+              << "                       (default fastqueue,deaod)" << std::endl
+              << "  --payload LIST       pointer, value, vector (1000 bytes) (default pointer)" << std::endl
+              << "  --size LIST          queue sizes, powers of two " << MIN_QUEUE_SIZE << " to " << MAX_QUEUE_SIZE << " (default 1024)" << std::endl
+              << "  --batch LIST         objects per push_n / pop_n in throughput mode, 1 is push / pop (default 1)" << std::endl
+              << "  --rate LIST          objects per second sent in the latency modes, 0 is unpaced (default 0)" << std::endl
+              << "  --cpus LIST          producer:consumer CPU pairs (default 3:1), all for every pair of CPU's or" << std::endl
+              << "                       sample:N for N of them (one of every topology relation first)" << std::endl
+              << "  --workers LIST       executor workers, on the CPU's from the consumer CPU up (default 4)" << std::endl
+              << "                       executor mode runs the dispatch and stealing pools instead of --queue" << std::endl
+              << "  --matrix             also print a producer x consumer matrix of the results" << std::endl
+              << "  --perf               count cycles, cache misses ... per object in throughput mode (perf_counters.h)" << std::endl
+              << "  --perf-raw CONFIG    also count this raw, CPU model specific event (e.g. a HITM event), implies --perf" << std::endl
+              << "  --duration-ms N      length of one run (default 2000)" << std::endl
+              << "  --warmup N           runs not measured before the measured ones (default 1)" << std::endl
+              << "  --repetitions N      measured runs (default 5)" << std::endl
+              << "  --csv FILE           write the results as CSV, - for stdout" << std::endl
+              << "  --json FILE          write the results as JSON, - for stdout" << std::endl;
+}
+
+std::vector<std::string> splitList(const std::string& rList) {
+    std::vector<std::string> lItems;
+    size_t lStart = 0;
+    while (lStart <= rList.size()) {
+        size_t lEnd = rList.find(',', lStart);
+        if (lEnd == std::string::npos) {
+            lEnd = rList.size();
+        }
+        if (lEnd > lStart) {
+            lItems.push_back(rList.substr(lStart, lEnd - lStart));
+        }
+        lStart = lEnd + 1;
+    }
+    return lItems;
+}
+
+//Every pair of different CPU's (producer < consumer)
+std::vector<std::pair<int32_t, int32_t>> allCpuPairs() {
+    std::vector<std::pair<int32_t, int32_t>> lPairs;
+    int32_t lCpus = static_cast<int32_t>(std::thread::hardware_concurrency());
+    for (int32_t lProducer = 0; lProducer < lCpus; ++lProducer) {
+        for (int32_t lConsumer = lProducer + 1; lConsumer < lCpus; ++lConsumer) {
+            lPairs.emplace_back(lProducer, lConsumer);
+        }
+    }
+    return lPairs;
+}
+
+//aCount pairs, the first pair of every topology relation and then pairs evenly spread over the rest
+std::vector<std::pair<int32_t, int32_t>> sampleCpuPairs(uint64_t aCount) {
+    std::vector<std::pair<int32_t, int32_t>> lAll = allCpuPairs();
+    if (aCount >= lAll.size()) {
+        return lAll;
+    }
+    std::vector<std::pair<int32_t, int32_t>> lSample;
+    std::vector<bool> lTaken(lAll.size(), false);
+    std::set<CpuRelation> lRelations;
+    for (uint64_t i = 0; i < lAll.size() && lSample.size() < aCount; ++i) {
+        if (lRelations.insert(cpuRelation(lAll[i].first, lAll[i].second)).second) {
+            lSample.push_back(lAll[i]);
+            lTaken[i] = true;
+        }
+    }
+    uint64_t lRemaining = aCount - lSample.size();
+    for (uint64_t i = 0; i < lRemaining; ++i) {
+        uint64_t lIndex = i * lAll.size() / lRemaining;
+        while (lTaken[lIndex]) {
+            lIndex = (lIndex + 1) % lAll.size();
+        }
+        lSample.push_back(lAll[lIndex]);
+        lTaken[lIndex] = true;
+    }
+    return lSample;
+}
+
+//Throws std::invalid_argument / std::out_of_range on a bad value
+bool parseArguments(int argc, char **argv, BenchConfig& rConfig) {
+    for (int i = 1; i < argc; ++i) {
+        std::string lOption = argv[i];
+        if (lOption == "--help" || lOption == "-h") {
+            return false;
+        }
+        if (lOption == "--matrix") {
+            rConfig.mMatrix = true;
+            continue;
+        }
+        if (lOption == "--perf") {
+            rConfig.mPerf = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cout << "Missing value for " << lOption << std::endl;
+            return false;
+        }
+        std::string lValue = argv[++i];
+        if (lOption == "--mode") {
+            rConfig.mModes = splitList(lValue);
+            for (const auto& rMode: rConfig.mModes) {
+                if (std::find_if(std::begin(MODES), std::end(MODES), [&](const char* pMode) { return rMode == pMode; }) == std::end(MODES)) {
+                    std::cout << "Unknown mode " << rMode << std::endl;
+                    return false;
+                }
+            }
+        } else if (lOption == "--queue") {
+            rConfig.mQueues = splitList(lValue);
+            for (const auto& rQueue: rConfig.mQueues) {
+                if (std::find_if(std::begin(QUEUES), std::end(QUEUES), [&](const char* pQueue) { return rQueue == pQueue; }) == std::end(QUEUES)) {
+                    std::cout << "Unknown queue " << rQueue << std::endl;
+                    return false;
+                }
+            }
+        } else if (lOption == "--payload") {
+            rConfig.mPayloads = splitList(lValue);
+            for (const auto& rPayload: rConfig.mPayloads) {
+                if (rPayload != PointerPayload::NAME && rPayload != ValuePayload::NAME && rPayload != VectorPayload::NAME) {
+                    std::cout << "Unknown payload " << rPayload << std::endl;
+                    return false;
+                }
+            }
+        } else if (lOption == "--size") {
+            rConfig.mSizes.clear();
+            for (const auto& rSize: splitList(lValue)) {
+                uint64_t lSize = std::stoull(rSize);
+                if (lSize < MIN_QUEUE_SIZE || lSize > MAX_QUEUE_SIZE || (lSize & (lSize - 1))) {
+                    std::cout << "Queue size " << lSize << " is not a power of two between " << MIN_QUEUE_SIZE << " and " << MAX_QUEUE_SIZE << std::endl;
+                    return false;
+                }
+                rConfig.mSizes.push_back(lSize);
+            }
+        } else if (lOption == "--batch") {
+            rConfig.mBatches.clear();
+            for (const auto& rBatch: splitList(lValue)) {
+                uint64_t lBatch = std::stoull(rBatch);
+                if (!lBatch) {
+                    std::cout << "The batch size must be at least 1" << std::endl;
+                    return false;
+                }
+                rConfig.mBatches.push_back(lBatch);
+            }
+        } else if (lOption == "--workers") {
+            rConfig.mWorkers.clear();
+            for (const auto& rWorkers: splitList(lValue)) {
+                uint64_t lWorkers = std::stoull(rWorkers);
+                if (!lWorkers) {
+                    std::cout << "The executor needs at least 1 worker" << std::endl;
+                    return false;
+                }
+                rConfig.mWorkers.push_back(lWorkers);
+            }
+        } else if (lOption == "--rate") {
+            rConfig.mRates.clear();
+            for (const auto& rRate: splitList(lValue)) {
+                rConfig.mRates.push_back(std::stoull(rRate));
+            }
+        } else if (lOption == "--cpus") {
+            rConfig.mCpus.clear();
+            if (lValue == "all" || lValue.rfind("sample:", 0) == 0) {
+                rConfig.mCpus = lValue == "all" ? allCpuPairs() : sampleCpuPairs(std::stoull(lValue.substr(7)));
+                if (rConfig.mCpus.empty()) {
+                    std::cout << "A CPU pair sweep needs at least 2 CPU's" << std::endl;
+                    return false;
+                }
+                continue;
+            }
+            for (const auto& rPair: splitList(lValue)) {
+                size_t lColon = rPair.find(':');
+                if (lColon == std::string::npos) {
+                    std::cout << "CPU pair " << rPair << " is not producer:consumer" << std::endl;
+                    return false;
+                }
+                rConfig.mCpus.emplace_back(std::stoi(rPair.substr(0, lColon)), std::stoi(rPair.substr(lColon + 1)));
+            }
+        } else if (lOption == "--perf-raw") {
+            rConfig.mPerf = true;
+            rConfig.mPerfRaw = std::stoull(lValue, nullptr, 0);
+        } else if (lOption == "--duration-ms") {
+            rConfig.mDurationMs = std::stoull(lValue);
+        } else if (lOption == "--warmup") {
+            rConfig.mWarmups = std::stoull(lValue);
+        } else if (lOption == "--repetitions") {
+            rConfig.mRepetitions = std::max<uint64_t>(1, std::stoull(lValue));
+        } else if (lOption == "--csv") {
+            rConfig.mCsvFile = lValue;
+        } else if (lOption == "--json") {
+            rConfig.mJsonFile = lValue;
+        } else {
+            std::cout << "Unknown option " << lOption << std::endl;
+            return false;
+        }
+    }
+    return !rConfig.mModes.empty() && !rConfig.mQueues.empty() && !rConfig.mPayloads.empty() &&
+           !rConfig.mSizes.empty() && !rConfig.mBatches.empty() && !rConfig.mCpus.empty() && !rConfig.mRates.empty() && !rConfig.mWorkers.empty();
+}
+
+int main(int argc, char **argv) {
+    BenchConfig lConfig;
+    try {
+        if (!parseArguments(argc, argv, lConfig)) {
+            printUsage();
+            return 1;
+        }
+    } catch (const std::exception& rError) {
+        std::cout << "Bad argument value (" << rError.what() << ")" << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    std::vector<BenchResult> lResults = expandCases(lConfig);
+    bool lFailed = false;
+    for (auto& rResult: lResults) {
+        lFailed |= !runCase(lConfig, rResult);
+        printResult(rResult);
+    }
+    if (lConfig.mMatrix) {
+        printMatrices(lResults);
+    }
+
+    if (!lConfig.mCsvFile.empty()) {
+        lFailed |= !writeOutput(lConfig.mCsvFile, [&](std::ostream& rOut) { writeCsv(rOut, lResults); });
+    }
+    if (!lConfig.mJsonFile.empty()) {
+        lFailed |= !writeOutput(lConfig.mJsonFile, [&](std::ostream& rOut) { writeJson(rOut, lConfig, lResults); });
+    }
+    return lFailed ? 1 : 0;
+}
@@ -15,21 +15,17 @@
 #include <thread>
 #include <numeric>
 #include "pin_thread.h"
-#if __x86_64__ || _M_X64
-#include "fast_queue_x86_64.h"
-#elif __aarch64__ || _M_ARM64
-#include "fast_queue_arm64.h"
-#else
-#error Architecture not supported
-#endif
+#include "fast_queue.h"
 
 #define QUEUE_MASK 0b1
 #define L1_CACHE_LINE 64
+#ifndef TEST_TIME_DURATION_SEC
 #define TEST_TIME_DURATION_SEC 200
+#endif
 
-bool gActiveProducer = true;
+std::atomic<bool> gActiveProducer = true;
 std::atomic<uint64_t> gActiveConsumer = 0;
-bool gStartBench = false;
+std::atomic<bool> gStartBench = false;
 std::atomic<uint64_t> gTransactions = 0;
 uint64_t gChk = 0;
 
@@ -106,8 +102,8 @@ void consumer(FastQueue<std::vector<uint8_t>*, QUEUE_MASK, L1_CACHE_LINE> *rQueu
 
 int main() {
     auto lQueue1 = new FastQueue<std::vector<uint8_t>*, QUEUE_MASK, L1_CACHE_LINE>();
-    std::thread([lQueue1] { return consumer(lQueue1, 0); }).detach();
-    std::thread([lQueue1] { return producer(lQueue1, 2); }).detach();
+    std::thread lConsumerThread([lQueue1] { return consumer(lQueue1, 0); });
+    std::thread lProducerThread([lQueue1] { return producer(lQueue1, 2); });
     std::cout << "Producer -> Consumer (start)" << std::endl;
     gStartBench = true;
     std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
@@ -117,6 +113,9 @@ int main() {
     while (gActiveConsumer) {
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
+    //The producer calls stopQueue() on its way out, don't delete the queue under it
+    lProducerThread.join();
+    lConsumerThread.join();
     delete lQueue1;
     std::cout << "Test ended. Did " << gTransactions << " transactions." << std::endl;
     return EXIT_SUCCESS;
@@ -0,0 +1,276 @@
+//
+// Fork based test of FastQueueIpc
+//
+
+// Every case runs the other side of the queue in a forked child process.
+// transfer: the parent creates the queue as the producer, the child opens it as the consumer and must get
+// TRANSFER_OBJECTS objects in order and then see the queue stopped.
+// header: open() of a missing queue and of a queue created with another ring size or object size returns nullptr,
+// the child opens the matching queue and reports back through it.
+// peer-exit: the child pushes PEER_EXIT_OBJECTS objects and waits, the parent pops them and kills the child, the next
+// pop() must return false instead of waiting for a producer that is gone.
+// consumer-detach / consumer-kill: the child consumer pops an object and detaches (or is killed), push() must then return false instead
+// of dropping the object or waiting for a consumer that is gone.
+// The test is killed by SIGALRM if it is not done within WATCHDOG_SEC.
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "fast_queue_ipc.h"
+
+#define L1_CACHE_LINE 64
+#define QUEUE_MASK 15
+#define TRANSFER_OBJECTS 100000
+#define PEER_EXIT_OBJECTS 5
+#define WATCHDOG_SEC 30
+
+struct Payload {
+    uint64_t mIndex;
+    uint64_t mCheck;
+};
+
+struct SmallPayload {
+    uint64_t mIndex;
+};
+
+using Queue = FastQueueIpc<Payload, QUEUE_MASK, L1_CACHE_LINE, FastQueueWait::ParkShared>;
+
+static Payload makePayload(uint64_t aIndex) {
+    return {aIndex, ~aIndex};
+}
+
+static bool isPayload(const Payload& rPayload, uint64_t aIndex) {
+    return rPayload.mIndex == aIndex && rPayload.mCheck == ~aIndex;
+}
+
+//A shared memory name of this process
+static std::string queueName(const char* aCase) {
+    return "/fast_queue_ipc_test_" + std::to_string(getpid()) + "_" + aCase;
+}
+
+//Run aChild in a forked process, its return value is the exit status
+template<typename Child>
+static pid_t forkChild(Child&& aChild) {
+    pid_t lPid = fork();
+    if (lPid == 0) {
+        _exit(aChild());
+    }
+    return lPid;
+}
+
+//Empty if the child exited with status 0
+static std::string joinChild(pid_t aPid) {
+    int lStatus = 0;
+    if (waitpid(aPid, &lStatus, 0) != aPid) {
+        return "waitpid failed";
+    }
+    if (!WIFEXITED(lStatus) || WEXITSTATUS(lStatus)) {
+        return "child failed with status " + std::to_string(WIFEXITED(lStatus) ? WEXITSTATUS(lStatus) : -1);
+    }
+    return {};
+}
+
+std::string testTransfer() {
+    const std::string lName = queueName("transfer");
+    auto lpQueue = Queue::create(lName.c_str(), Queue::Side::Producer);
+    if (!lpQueue) {
+        return "create failed";
+    }
+    pid_t lChild = forkChild([&lName] {
+        auto lpConsumer = Queue::open(lName.c_str(), Queue::Side::Consumer);
+        if (!lpConsumer) {
+            return 2;
+        }
+        Payload lPayload{};
+        for (uint64_t i = 0; i < TRANSFER_OBJECTS; ++i) {
+            if (!lpConsumer->pop(lPayload) || !isPayload(lPayload, i)) {
+                return 3;
+            }
+        }
+        //Stopped and empty
+        return lpConsumer->pop(lPayload) ? 4 : 0;
+    });
+    if (lChild < 0) {
+        return "fork failed";
+    }
+    std::string lError;
+    for (uint64_t i = 0; i < TRANSFER_OBJECTS; ++i) {
+        Payload* lpPayload = lpQueue->reserve();
+        if (!lpPayload) {
+            lError = "reserve failed at object " + std::to_string(i);
+            break;
+        }
+        *lpPayload = makePayload(i);
+        lpQueue->commit();
+    }
+    lpQueue->stopQueue();
+    if (lError.empty() && lpQueue->push(makePayload(0))) {
+        lError = "push() to a stopped queue succeeded";
+    }
+    std::string lChildError = joinChild(lChild);
+    return lError.empty() ? lChildError : lError;
+}
+
+std::string testHeader() {
+    const std::string lName = queueName("header");
+    auto lpQueue = Queue::create(lName.c_str(), Queue::Side::Consumer);
+    if (!lpQueue) {
+        return "create failed";
+    }
+    if (Queue::open((lName + "_missing").c_str(), Queue::Side::Producer)) {
+        return "open of a missing queue succeeded";
+    }
+    using OtherSize = FastQueueIpc<Payload, QUEUE_MASK * 2 + 1, L1_CACHE_LINE, FastQueueWait::ParkShared>;
+    if (OtherSize::open(lName.c_str(), OtherSize::Side::Producer)) {
+        return "open with another ring size succeeded";
+    }
+    using OtherObject = FastQueueIpc<SmallPayload, QUEUE_MASK, L1_CACHE_LINE, FastQueueWait::ParkShared>;
+    if (OtherObject::open(lName.c_str(), OtherObject::Side::Producer)) {
+        return "open with another object size succeeded";
+    }
+    pid_t lChild = forkChild([&lName] {
+        auto lpProducer = Queue::open(lName.c_str(), Queue::Side::Producer);
+        if (!lpProducer) {
+            return 2;
+        }
+        lpProducer->push(makePayload(1));
+        return 0;
+    });
+    if (lChild < 0) {
+        return "fork failed";
+    }
+    Payload lPayload{};
+    if (!lpQueue->pop(lPayload) || !isPayload(lPayload, 1)) {
+        //The child failed to open, it won't push
+        std::string lChildError = joinChild(lChild);
+        return "no object from the child" + (lChildError.empty() ? "" : ", " + lChildError);
+    }
+    return joinChild(lChild);
+}
+
+std::string testPeerExit() {
+    const std::string lName = queueName("peer_exit");
+    auto lpQueue = Queue::create(lName.c_str(), Queue::Side::Consumer);
+    if (!lpQueue) {
+        return "create failed";
+    }
+    pid_t lChild = forkChild([&lName] {
+        auto lpProducer = Queue::open(lName.c_str(), Queue::Side::Producer);
+        if (!lpProducer) {
+            return 2;
+        }
+        for (uint64_t i = 0; i < PEER_EXIT_OBJECTS; ++i) {
+            lpProducer->push(makePayload(i));
+        }
+        //Killed here, without detaching
+        while (true) {
+            pause();
+        }
+    });
+    if (lChild < 0) {
+        return "fork failed";
+    }
+    Payload lPayload{};
+    std::string lError;
+    for (uint64_t i = 0; i < PEER_EXIT_OBJECTS && lError.empty(); ++i) {
+        if (!lpQueue->pop(lPayload) || !isPayload(lPayload, i)) {
+            lError = "object " + std::to_string(i) + " missing";
+        }
+    }
+    kill(lChild, SIGKILL);
+    //Reaped, a zombie still counts as alive
+    int lStatus = 0;
+    waitpid(lChild, &lStatus, 0);
+    if (!lError.empty()) {
+        return lError;
+    }
+    if (!WIFSIGNALED(lStatus)) {
+        return "child exited before it was killed";
+    }
+    if (lpQueue->isPeerAlive()) {
+        return "killed producer reported alive";
+    }
+    return lpQueue->pop(lPayload) ? "pop() returned an object after the producer died" : "";
+}
+
+std::string testConsumerExit(bool aKill) {
+    const std::string lName = queueName(aKill ? "consumer_kill" : "consumer_detach");
+    auto lpQueue = Queue::create(lName.c_str(), Queue::Side::Producer);
+    if (!lpQueue) {
+        return "create failed";
+    }
+    pid_t lChild = forkChild([&lName, aKill] {
+        auto lpConsumer = Queue::open(lName.c_str(), Queue::Side::Consumer);
+        if (!lpConsumer) {
+            return 2;
+        }
+        Payload lPayload{};
+        if (!lpConsumer->pop(lPayload) || !isPayload(lPayload, 0)) {
+            return 3;
+        }
+        //Killed here, without detaching
+        while (aKill) {
+            pause();
+        }
+        return 0;
+    });
+    if (lChild < 0) {
+        return "fork failed";
+    }
+    //With a full ring the last push waits until the child popped object 0, so it is attached when it is killed
+    uint64_t lPushes = aKill ? QUEUE_MASK + 2 : 1;
+    std::string lError;
+    for (uint64_t i = 0; i < lPushes && lError.empty(); ++i) {
+        if (!lpQueue->push(makePayload(i))) {
+            lError = "push() of object " + std::to_string(i) + " failed";
+        }
+    }
+    if (aKill) {
+        kill(lChild, SIGKILL);
+        //Reaped, a zombie still counts as alive
+        int lStatus = 0;
+        waitpid(lChild, &lStatus, 0);
+    } else {
+        std::string lChildError = joinChild(lChild);
+        if (lError.empty()) {
+            lError = lChildError;
+        }
+    }
+    if (!lError.empty()) {
+        return lError;
+    }
+    //The ring is full after a kill, the push finds the consumer gone while it waits
+    if (lpQueue->push(makePayload(lPushes))) {
+        return aKill ? "push() succeeded after the consumer was killed" : "push() succeeded after the consumer detached";
+    }
+    if (!aKill && lpQueue->try_push(makePayload(lPushes))) {
+        return "try_push() succeeded after the consumer detached";
+    }
+    return {};
+}
+
+int main() {
+    alarm(WATCHDOG_SEC);
+    struct Case {
+        const char* mName;
+        std::string (*mRun)();
+    };
+    const Case lCases[] = {{"transfer", testTransfer}, {"header", testHeader}, {"peer-exit", testPeerExit},
+            {"consumer-detach", [] { return testConsumerExit(false); }}, {"consumer-kill", [] { return testConsumerExit(true); }}};
+    uint64_t lPassed = 0;
+    for (const auto& rCase: lCases) {
+        std::string lError = rCase.mRun();
+        if (lError.empty()) {
+            lPassed++;
+        } else {
+            std::cout << rCase.mName << " failed: " << lError << std::endl;
+        }
+    }
+    std::cout << "Test ended. " << lPassed << " of " << std::size(lCases) << " cases passed." << std::endl;
+    return lPassed == std::size(lCases) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,12 @@
+//
+// Second translation unit of fast_queue_stress_test
+//
+
+// Includes the headers FastQueueStressTest.cpp includes as well, so a function defined in a header without inline
+// fails the link (multiple definition) instead of the first program using two translation units.
+// Only the branches of the platform it is built on are checked, the macOS replacements pin_thread.h defines for
+// sched_getaffinity / pthread_setaffinity_np are static inline for that reason.
+
+#include "pin_thread.h"
+#include "fast_queue_executor.h"
+#include "fast_queue_pipeline.h"
@@ -0,0 +1,1455 @@
+//
+// Stress and fuzz matrix for every queue variant
+//
+
+// Runs every queue variant across queue sizes, push / pop API's, batch sizes, timing jitter patterns on each side and
+// two endings, many short cases instead of one long run. Every object carries its producer, a per producer counter
+// and a checksum, every consumer verifies the checksum and that each producer's counter is linear.
+// drain: the (last) producer stops the queue, the consumers must get every object pushed before the stop.
+// race: a third thread calls stopQueue() at a random time while the producers push, the consumers must get an in
+// order prefix of what was pushed and every thread has to return.
+// The doorbell cases check that a consumer sleeping in poll() gets exactly one ring per sleep.
+// The executor cases check that every submitted and spawned task runs exactly once, with and without stealing.
+// Heap objects are counted, an object the queue lost or did not delete (owning slot carrier) fails the case. A case
+// not done within WATCHDOG_SEC after its duration is reported as a hang and ends the test.
+//
+// ./fast_queue_stress_test --duration-ms 100 --filter owned --seed 1234
+
+#include <random>
+#include <iostream>
+#include <thread>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include "fast_queue.h"
+#include "fast_queue_inline.h"
+#include "fast_queue_mpsc.h"
+#include "fast_queue_broadcast.h"
+#include "fast_queue_dynamic.h"
+#include "fast_queue_pool.h"
+#include "fast_queue_executor.h"
+#include "fast_queue_pipeline.h"
+#if defined(__cpp_impl_coroutine)
+#include "fast_queue_coro.h"
+#endif
+#if defined __linux || defined __APPLE__
+#include <poll.h>
+#include "fast_queue_doorbell.h"
+#endif
+
+#define L1_CACHE_LINE 64
+#define WATCHDOG_SEC 30
+
+//Push / pop API's. For the variants without a matching consumer API the producer side is what varies.
+enum class Api : uint64_t {
+    Blocking,   //push / pop
+    Bounded,    //push_for / pop_for
+    Try,        //try_push / try_pop
+    Timed,      //push_until / pop_until
+    Batch,      //push_n / pop_n
+    ConsumeAll, //push_n / consume_all
+    Drain,      //push_n / drain
+    InPlace,    //reserve + commit / front + release
+    COUNT
+};
+
+static const char* const API_NAMES[] = {"blocking", "bounded", "try", "timed", "batch", "consume-all", "drain", "in-place"};
+
+static constexpr uint64_t apiBit(Api aApi) {
+    return 1ULL << static_cast<uint64_t>(aApi);
+}
+
+static constexpr uint64_t FAST_QUEUE_APIS = apiBit(Api::Blocking) | apiBit(Api::Bounded) | apiBit(Api::Try) |
+        apiBit(Api::Timed) | apiBit(Api::Batch) | apiBit(Api::ConsumeAll) | apiBit(Api::Drain);
+
+static bool isBatchApi(Api aApi) {
+    return aApi == Api::Batch || aApi == Api::ConsumeAll || aApi == Api::Drain;
+}
+
+enum class Jitter {
+    None,   //As fast as possible
+    Random, //1 - 500 ns sleep after every call (the integrity test)
+    Burst,  //Up to two queues worth of calls back to back, then up to 200 us sleep (full / empty flips)
+    Stall   //A 1 - 4 ms sleep every ~4096 calls (a preempted side)
+};
+
+static const char* const JITTER_NAMES[] = {"none", "random", "burst", "stall"};
+
+//Producer / consumer jitter pairs, the cases rotate through them (--all-jitters runs every pair for every case)
+static const std::pair<Jitter, Jitter> JITTER_PAIRS[] = {
+        {Jitter::None,   Jitter::None},
+        {Jitter::Random, Jitter::Random},
+        {Jitter::None,   Jitter::Random},
+        {Jitter::Random, Jitter::None},
+        {Jitter::Burst,  Jitter::None},
+        {Jitter::None,   Jitter::Burst},
+        {Jitter::Stall,  Jitter::Burst},
+        {Jitter::Burst,  Jitter::Stall}
+};
+
+enum class Ending {
+    Drain,
+    Race
+};
+
+//Queue masks (2, 16 and 1024 entries) and the batch sizes of the batch API's
+static const uint64_t MASKS[] = {1, 15, 1023};
+static const uint64_t BATCHES[] = {1, 5, 64};
+
+struct StressCase {
+    std::string mName;
+    uint64_t mMask = 0;
+    Api mApi = Api::Blocking;
+    uint64_t mBatch = 1;
+    Jitter mProducerJitter = Jitter::None;
+    Jitter mConsumerJitter = Jitter::None;
+    Ending mEnding = Ending::Drain;
+    uint64_t mSeed = 0;
+    std::chrono::milliseconds mDuration{0};
+};
+
+//Object encoding, bits 16..47 the counter (from 1, so an object is never 0), 8..15 the producer, 0..7 a checksum.
+//Fits the 48 payload bits of FastQueueSlot::Tagged.
+static uint64_t valueCheck(uint64_t aBody) {
+    return (aBody * 0x9E3779B97F4A7C15ULL) >> 56;
+}
+
+static uint64_t encodeValue(uint64_t aProducer, uint64_t aCounter) {
+    uint64_t lBody = (aCounter << 16) | (aProducer << 8);
+    return lBody | valueCheck(lBody);
+}
+
+//A multi word object, a torn or stale copy does not pass get()
+struct Message {
+    void set(uint64_t aValue) {
+        mValue = aValue;
+        for (uint64_t i = 0; i < 3; ++i) {
+            mMirror[i] = (aValue + i) * 0xBF58476D1CE4E5B9ULL;
+        }
+    }
+    //The value, 0 if the words don't match
+    uint64_t get() const {
+        for (uint64_t i = 0; i < 3; ++i) {
+            if (mMirror[i] != (mValue + i) * 0xBF58476D1CE4E5B9ULL) {
+                return 0;
+            }
+        }
+        return mValue;
+    }
+    uint64_t mValue = 0;
+    uint64_t mMirror[3] = {};
+};
+
+std::atomic<int64_t> gLiveMessages = 0;
+
+//Heap message, counted so a lost or leaked one is found
+struct HeapMessage : Message {
+    explicit HeapMessage(uint64_t aValue) {
+        set(aValue);
+        gLiveMessages++;
+    }
+    HeapMessage(const HeapMessage&) = delete;
+    HeapMessage& operator=(const HeapMessage&) = delete;
+    ~HeapMessage() {
+        gLiveMessages--;
+    }
+};
+
+//Element codecs for the 8 byte queues
+struct ValueCodec {
+    using Element = uint64_t;
+    static Element make(uint64_t aValue) {
+        return aValue;
+    }
+    static uint64_t take(Element aElement) {
+        return aElement;
+    }
+    static void discard(Element&) {}
+};
+
+struct PointerCodec {
+    using Element = HeapMessage*;
+    static Element make(uint64_t aValue) {
+        return new HeapMessage(aValue);
+    }
+    static uint64_t take(Element pElement) {
+        uint64_t lValue = pElement->get();
+        delete pElement;
+        return lValue;
+    }
+    static void discard(Element& rElement) {
+        delete rElement;
+        rElement = nullptr;
+    }
+};
+
+struct OwnerCodec {
+    using Element = std::unique_ptr<HeapMessage>;
+    static Element make(uint64_t aValue) {
+        return std::make_unique<HeapMessage>(aValue);
+    }
+    static uint64_t take(Element aElement) {
+        return aElement->get();
+    }
+    static void discard(Element& rElement) {
+        rElement.reset();
+    }
+};
+
+//FastQueue with every push / pop API. Objects a plain (not owning) queue still holds after the run are popped and
+//deleted by the destructor, an owning queue has to delete them itself.
+template<typename Codec, uint64_t MASK, typename WaitPolicy = FastQueueWait::Spin,
+        typename ArchTraits = FastQueueArchTraits<L1_CACHE_LINE>,
+        typename SlotCarrier = FastQueueSlot::Default<typename Codec::Element>, typename Stats = FastQueueStats::None>
+class FastQueueAdapter {
+public:
+    using Element = typename Codec::Element;
+    static constexpr uint64_t PRODUCERS = 1;
+    static constexpr uint64_t CONSUMERS = 1;
+    static constexpr uint64_t APIS = FAST_QUEUE_APIS;
+    static constexpr bool EXACT_STOP = true;
+
+    ~FastQueueAdapter() {
+        if constexpr (!SlotCarrier::OWNING) {
+            Element lElement{};
+            while (mQueue.try_pop(lElement)) {
+                Codec::take(std::move(lElement));
+            }
+        }
+    }
+
+    //Returns the number of objects pushed, less than aCount if the queue is stopped
+    uint64_t push(uint64_t, const uint64_t* pValues, uint64_t aCount, Api aApi, const std::atomic<bool>& rStop) {
+        if (isBatchApi(aApi)) {
+            mPushItems.clear();
+            for (uint64_t i = 0; i < aCount; ++i) {
+                mPushItems.push_back(Codec::make(pValues[i]));
+            }
+            uint64_t lPushed = mQueue.push_n(mPushItems.begin(), aCount);
+            for (uint64_t i = lPushed; i < aCount; ++i) {
+                Codec::discard(mPushItems[i]);
+            }
+            mPushed += lPushed;
+            return lPushed;
+        }
+        for (uint64_t i = 0; i < aCount; ++i) {
+            if (!pushOne(Codec::make(pValues[i]), aApi, rStop)) {
+                return i;
+            }
+            mPushed++;
+        }
+        return aCount;
+    }
+
+    //Pass up to aMax objects to rSink. Returns the number of objects, 0 when the queue is stopped and drained.
+    template<typename Sink>
+    uint64_t pop(uint64_t, uint64_t aMax, Api aApi, Sink&& rSink) {
+        Element lElement{};
+        switch (aApi) {
+            case Api::Blocking:
+                mQueue.pop(lElement);
+                if (isEmpty(lElement)) {
+                    return 0;
+                }
+                break;
+            case Api::Bounded:
+                while (!mQueue.pop_for(lElement, 64)) {
+                    if (mQueue.isStoppedAndEmpty()) {
+                        return 0;
+                    }
+                }
+                break;
+            case Api::Try:
+                while (!mQueue.try_pop(lElement)) {
+                    if (mQueue.isStoppedAndEmpty()) {
+                        return 0;
+                    }
+                    std::this_thread::yield();
+                }
+                break;
+            case Api::Timed:
+                while (true) {
+                    FastQueueStatus lStatus = mQueue.pop_until(lElement, std::chrono::steady_clock::now() + std::chrono::microseconds(100));
+                    if (lStatus == FastQueueStatus::Ok) {
+                        break;
+                    }
+                    if (lStatus == FastQueueStatus::Stopped) {
+                        return 0;
+                    }
+                }
+                break;
+            case Api::Batch: {
+                mPopItems.resize(aMax);
+                uint64_t lCount = mQueue.pop_n(mPopItems.begin(), aMax);
+                for (uint64_t i = 0; i < lCount; ++i) {
+                    rSink(Codec::take(std::move(mPopItems[i])));
+                }
+                return lCount;
+            }
+            case Api::ConsumeAll:
+                while (true) {
+                    if (uint64_t lCount = mQueue.consume_all([&rSink](Element aElement) { rSink(Codec::take(std::move(aElement))); })) {
+                        return lCount;
+                    }
+                    if (mQueue.isStoppedAndEmpty()) {
+                        return 0;
+                    }
+                    std::this_thread::yield();
+                }
+            case Api::Drain:
+                return mQueue.drain([&rSink](Element aElement) { rSink(Codec::take(std::move(aElement))); });
+            default:
+                return 0;
+        }
+        rSink(Codec::take(std::move(lElement)));
+        return 1;
+    }
+
+    void stop() {
+        mQueue.stopQueue();
+    }
+
+    //After the threads are joined, aReceived is the number of objects the consumer got. With counters the queue is
+    //reset() as well, the counters must start from 0 again.
+    std::string check(uint64_t aReceived) {
+        if constexpr (Stats::ENABLED) {
+            FastQueueStats::Snapshot lStats = mQueue.stats();
+            if (lStats.mPushes != mPushed || lStats.mPops != aReceived) {
+                return "stats count " + std::to_string(lStats.mPushes) + " pushes / " + std::to_string(lStats.mPops) +
+                       " pops, pushed " + std::to_string(mPushed) + " received " + std::to_string(aReceived);
+            }
+            Element lElement{};
+            while (mQueue.try_pop(lElement)) {
+                Codec::take(std::move(lElement));
+            }
+            mQueue.reset();
+            lStats = mQueue.stats();
+            if (lStats.mPushes || lStats.mPops || lStats.mFullSpins || lStats.mEmptySpins || lStats.mMaxDepth) {
+                return "stats not 0 after reset()";
+            }
+        }
+        return {};
+    }
+
+private:
+    bool pushOne(Element aElement, Api aApi, const std::atomic<bool>& rStop) {
+        bool lPushed = false;
+        switch (aApi) {
+            case Api::Blocking:
+                lPushed = mQueue.push(std::move(aElement));
+                break;
+            case Api::Bounded:
+                //A failed push leaves the object with the caller, a closed queue fails every push
+                while (!(lPushed = mQueue.push_for(64, std::move(aElement))) && !rStop) {}
+                break;
+            case Api::Try:
+                while (!(lPushed = mQueue.try_push(std::move(aElement))) && !rStop) {
+                    std::this_thread::yield();
+                }
+                break;
+            case Api::Timed: {
+                FastQueueStatus lStatus;
+                while ((lStatus = mQueue.push_until(std::chrono::steady_clock::now() + std::chrono::microseconds(100),
+                                                    std::move(aElement))) == FastQueueStatus::Timeout) {}
+                lPushed = lStatus == FastQueueStatus::Ok;
+                break;
+            }
+            default:
+                break;
+        }
+        if (!lPushed) {
+            Codec::discard(aElement);
+        }
+        return lPushed;
+    }
+
+    static bool isEmpty(const Element& rElement) {
+        if constexpr (SlotCarrier::OWNING) {
+            return !rElement;
+        } else {
+            return rElement == SlotCarrier::decode(SlotCarrier::EMPTY);
+        }
+    }
+
+    FastQueue<Element, MASK, L1_CACHE_LINE, WaitPolicy, ArchTraits, SlotCarrier, Stats> mQueue;
+    std::vector<Element> mPushItems;
+    std::vector<Element> mPopItems;
+    uint64_t mPushed = 0;
+};
+
+template<uint64_t MASK>
+class InlineAdapter {
+public:
+    static constexpr uint64_t PRODUCERS = 1;
+    static constexpr uint64_t CONSUMERS = 1;
+    static constexpr uint64_t APIS = apiBit(Api::Blocking) | apiBit(Api::Try) | apiBit(Api::InPlace);
+
+    uint64_t push(uint64_t, const uint64_t* pValues, uint64_t aCount, Api aApi, const std::atomic<bool>& rStop) {
+        for (uint64_t i = 0; i < aCount; ++i) {
+            if (aApi == Api::InPlace) {
+                Message* lpMessage = mQueue.reserve();
+                if (!lpMessage) {
+                    return i;
+                }
+                lpMessage->set(pValues[i]);
+                mQueue.commit();
+                continue;
+            }
+            Message lMessage;
+            lMessage.set(pValues[i]);
+            bool lPushed;
+            if (aApi == Api::Try) {
+                while (!(lPushed = mQueue.try_push(lMessage)) && !rStop) {
+                    std::this_thread::yield();
+                }
+            } else {
+                lPushed = mQueue.push(lMessage);
+            }
+            if (!lPushed) {
+                return i;
+            }
+        }
+        return aCount;
+    }
+
+    template<typename Sink>
+    uint64_t pop(uint64_t, uint64_t, Api aApi, Sink&& rSink) {
+        if (aApi == Api::InPlace) {
+            const Message* lpMessage = mQueue.front();
+            if (!lpMessage) {
+                return 0;
+            }
+            rSink(lpMessage->get());
+            mQueue.release();
+            return 1;
+        }
+        Message lMessage;
+        if (!mQueue.pop(lMessage)) {
+            return 0;
+        }
+        rSink(lMessage.get());
+        return 1;
+    }
+
+    void stop() {
+        mQueue.stopQueue();
+    }
+
+    std::string check(uint64_t) const {
+        return {};
+    }
+
+private:
+    FastQueueInline<Message, MASK, L1_CACHE_LINE> mQueue;
+};
+
+//One producer thread per lane, the consumer pops round robin
+template<uint64_t MASK, typename WaitPolicy = FastQueueWait::Spin>
+class MpscAdapter {
+public:
+    static constexpr uint64_t PRODUCERS = 3;
+    static constexpr uint64_t CONSUMERS = 1;
+    static constexpr uint64_t APIS = apiBit(Api::Blocking) | apiBit(Api::Try) | apiBit(Api::Batch);
+    static constexpr bool EXACT_STOP = true;
+
+    MpscAdapter() {
+        for (auto &rLane: mLanes) {
+            rLane = mQueue.registerProducer();
+        }
+    }
+
+    uint64_t push(uint64_t aProducer, const uint64_t* pValues, uint64_t aCount, Api aApi, const std::atomic<bool>& rStop) {
+        int32_t lLane = mLanes[aProducer];
+        if (aApi == Api::Batch) {
+            return mQueue.lane(lLane).push_n(pValues, aCount);
+        }
+        for (uint64_t i = 0; i < aCount; ++i) {
+            bool lPushed;
+            if (aApi == Api::Try) {
+                while (!(lPushed = mQueue.lane(lLane).try_push(pValues[i])) && !rStop) {
+                    std::this_thread::yield();
+                }
+            } else {
+                lPushed = mQueue.push(lLane, pValues[i]);
+            }
+            if (!lPushed) {
+                return i;
+            }
+        }
+        return aCount;
+    }
+
+    template<typename Sink>
+    uint64_t pop(uint64_t, uint64_t, Api, Sink&& rSink) {
+        uint64_t lValue;
+        mQueue.pop(lValue);
+        if (!lValue) {
+            return 0;
+        }
+        rSink(lValue);
+        return 1;
+    }
+
+    void stop() {
+        mQueue.stopQueue();
+    }
+
+    std::string check(uint64_t) const {
+        return {};
+    }
+
+private:
+    MpscFastQueue<uint64_t, MASK, L1_CACHE_LINE, PRODUCERS, WaitPolicy> mQueue;
+    std::array<int32_t, PRODUCERS> mLanes{};
+};
+
+//Every consumer gets every object
+template<uint64_t MASK>
+class BroadcastAdapter {
+public:
+    static constexpr uint64_t PRODUCERS = 1;
+    static constexpr uint64_t CONSUMERS = 3;
+    static constexpr uint64_t APIS = apiBit(Api::Blocking);
+
+    uint64_t push(uint64_t, const uint64_t* pValues, uint64_t aCount, Api, const std::atomic<bool>&) {
+        for (uint64_t i = 0; i < aCount; ++i) {
+            Message lMessage;
+            lMessage.set(pValues[i]);
+            if (!mQueue.push(lMessage)) {
+                return i;
+            }
+        }
+        return aCount;
+    }
+
+    template<typename Sink>
+    uint64_t pop(uint64_t aConsumer, uint64_t, Api, Sink&& rSink) {
+        Message lMessage;
+        if (!mQueue.pop(aConsumer, lMessage)) {
+            return 0;
+        }
+        rSink(lMessage.get());
+        return 1;
+    }
+
+    void stop() {
+        mQueue.stopQueue();
+    }
+
+    std::string check(uint64_t) const {
+        return {};
+    }
+
+private:
+    FastQueueBroadcast<Message, MASK, L1_CACHE_LINE, CONSUMERS> mQueue;
+};
+
+//Objects a plain (not owning) queue still holds after the run are popped and deleted by the destructor, an owning
+//queue has to delete them itself (in unbounded mode they may be spread over several segments)
+template<typename Codec, uint64_t MASK, bool UNBOUNDED>
+class DynamicAdapter {
+public:
+    using Element = typename Codec::Element;
+    using SlotCarrier = FastQueueSlot::Default<Element>;
+    static constexpr uint64_t PRODUCERS = 1;
+    static constexpr uint64_t CONSUMERS = 1;
+    static constexpr uint64_t APIS = apiBit(Api::Blocking) | apiBit(Api::Try);
+
+    ~DynamicAdapter() {
+        if constexpr (!SlotCarrier::OWNING) {
+            Element lElement{};
+            while (mQueue.try_pop(lElement)) {
+                Codec::take(std::move(lElement));
+            }
+        }
+    }
+
+    uint64_t push(uint64_t, const uint64_t* pValues, uint64_t aCount, Api aApi, const std::atomic<bool>& rStop) {
+        for (uint64_t i = 0; i < aCount; ++i) {
+            Element lElement = Codec::make(pValues[i]);
+            if (aApi == Api::Try) {
+                while (!mQueue.try_push(std::move(lElement))) {
+                    if (rStop) {
+                        Codec::discard(lElement);
+                        return i;
+                    }
+                    std::this_thread::yield();
+                }
+            } else if (!mQueue.push(std::move(lElement))) {
+                Codec::discard(lElement);
+                return i;
+            }
+        }
+        return aCount;
+    }
+
+    template<typename Sink>
+    uint64_t pop(uint64_t, uint64_t, Api aApi, Sink&& rSink) {
+        Element lElement{};
+        if (aApi == Api::Try) {
+            while (!mQueue.try_pop(lElement)) {
+                if (mQueue.isStoppedAndEmpty()) {
+                    return 0;
+                }
+                std::this_thread::yield();
+            }
+        } else {
+            mQueue.pop(lElement);
+            if (!lElement) {
+                return 0;
+            }
+        }
+        rSink(Codec::take(std::move(lElement)));
+        return 1;
+    }
+
+    void stop() {
+        mQueue.stopQueue();
+    }
+
+    std::string check(uint64_t) const {
+        return {};
+    }
+
+private:
+    FastQueueDynamic<Element, L1_CACHE_LINE> mQueue{MASK + 1, UNBOUNDED};
+};
+
+//The consumer recycles every message, so the producer reuses them while the consumer may still hold a stale copy
+template<uint64_t MASK>
+class PoolAdapter {
+public:
+    static constexpr uint64_t PRODUCERS = 1;
+    static constexpr uint64_t CONSUMERS = 1;
+    static constexpr uint64_t APIS = apiBit(Api::Blocking);
+
+    uint64_t push(uint64_t, const uint64_t* pValues, uint64_t aCount, Api, const std::atomic<bool>&) {
+        for (uint64_t i = 0; i < aCount; ++i) {
+            Message* lpMessage = mQueue.acquire();
+            if (!lpMessage) {
+                return i;
+            }
+            lpMessage->set(pValues[i]);
+            if (!mQueue.push(lpMessage)) {
+                return i;
+            }
+        }
+        return aCount;
+    }
+
+    template<typename Sink>
+    uint64_t pop(uint64_t, uint64_t, Api, Sink&& rSink) {
+        Message* lpMessage = nullptr;
+        mQueue.pop(lpMessage);
+        if (!lpMessage) {
+            return 0;
+        }
+        rSink(lpMessage->get());
+        mQueue.recycle(lpMessage);
+        return 1;
+    }
+
+    void stop() {
+        mQueue.stopQueue();
+    }
+
+    std::string check(uint64_t) const {
+        return {};
+    }
+
+private:
+    FastQueuePool<Message, MASK, L1_CACHE_LINE> mQueue;
+};
+
+//Four stages on three threads: make a heap message, a fused pass through, check it, push the value to the consumer.
+//stop() stops the pipeline (drains the stages in order) and then the output queue.
+template<uint64_t MASK>
+class PipelineAdapter {
+public:
+    static constexpr uint64_t PRODUCERS = 1;
+    static constexpr uint64_t CONSUMERS = 1;
+    static constexpr uint64_t APIS = apiBit(Api::Blocking) | apiBit(Api::Batch);
+    using Pipeline = FastQueuePipeline<uint64_t, MASK, L1_CACHE_LINE>;
+
+    PipelineAdapter() : mpPipeline(Pipeline::builder()
+            .stage([](uint64_t aValue) {
+                return std::make_unique<HeapMessage>(aValue);
+            })
+            .fuse([](std::unique_ptr<HeapMessage> pMessage) {
+                return pMessage;
+            })
+            .stage([](std::unique_ptr<HeapMessage> pMessage) {
+                return pMessage->get();
+            })
+            .stage([this](uint64_t aValue) {
+                mOut.push(aValue);
+            })
+            .build()) {}
+
+    uint64_t push(uint64_t, const uint64_t* pValues, uint64_t aCount, Api aApi, const std::atomic<bool>&) {
+        if (aApi == Api::Batch) {
+            return mpPipeline->push_n(pValues, aCount);
+        }
+        for (uint64_t i = 0; i < aCount; ++i) {
+            if (!mpPipeline->push(pValues[i])) {
+                return i;
+            }
+        }
+        return aCount;
+    }
+
+    template<typename Sink>
+    uint64_t pop(uint64_t, uint64_t aMax, Api aApi, Sink&& rSink) {
+        if (aApi == Api::Batch) {
+            mPopItems.resize(aMax);
+            uint64_t lCount = mOut.pop_n(mPopItems.begin(), aMax);
+            for (uint64_t i = 0; i < lCount; ++i) {
+                rSink(mPopItems[i]);
+            }
+            return lCount;
+        }
+        uint64_t lValue = 0;
+        mOut.pop(lValue);
+        if (!lValue) {
+            return 0;
+        }
+        rSink(lValue);
+        return 1;
+    }
+
+    void stop() {
+        mpPipeline->stop();
+        mOut.stopQueue();
+    }
+
+    std::string check(uint64_t) const {
+        if (mpPipeline->threads() != 3) {
+            return std::to_string(mpPipeline->threads()) + " pipeline threads, expected 3";
+        }
+        return {};
+    }
+
+private:
+    FastQueue<uint64_t, MASK, L1_CACHE_LINE> mOut;
+    std::vector<uint64_t> mPopItems;
+    //Destroyed first, the sink pushes to mOut
+    std::unique_ptr<Pipeline> mpPipeline;
+};
+
+#if defined(__cpp_impl_coroutine)
+struct DetachedCoroutine {
+    struct promise_type {
+        DetachedCoroutine get_return_object() {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+//Both sides are coroutines awaiting owned heap messages. LOOP false resumes a suspended side inline on the thread of
+//the other side, LOOP true posts it to the one slot event loop the side's own thread runs until the call is done.
+template<uint64_t MASK, bool LOOP>
+class AwaitAdapter {
+public:
+    static constexpr uint64_t PRODUCERS = 1;
+    static constexpr uint64_t CONSUMERS = 1;
+    static constexpr uint64_t APIS = apiBit(Api::Blocking);
+
+    uint64_t push(uint64_t, const uint64_t* pValues, uint64_t aCount, Api, const std::atomic<bool>&) {
+        std::atomic<uint64_t> lPushed = NOT_DONE;
+        pushCoroutine(pValues, aCount, &lPushed);
+        run(mProducerLoop, lPushed);
+        return lPushed;
+    }
+
+    template<typename Sink>
+    uint64_t pop(uint64_t, uint64_t, Api, Sink&& rSink) {
+        std::atomic<uint64_t> lPopped = NOT_DONE;
+        popCoroutine(&rSink, &lPopped);
+        run(mConsumerLoop, lPopped);
+        return lPopped;
+    }
+
+    void stop() {
+        mQueue.stopQueue();
+    }
+
+    std::string check(uint64_t) const {
+        return {};
+    }
+
+private:
+    static constexpr uint64_t NOT_DONE = UINT64_MAX;
+
+    struct Loop {
+        std::atomic<void*> mPosted = nullptr;
+    };
+
+    struct Post {
+        void operator()(std::coroutine_handle<> aHandle) const {
+            mpLoop->mPosted.store(aHandle.address(), std::memory_order_release);
+        }
+        Loop* mpLoop;
+    };
+
+    static auto scheduler(Loop& rLoop) {
+        if constexpr (LOOP) {
+            return Post{&rLoop};
+        } else {
+            return FastQueueResumeInline{};
+        }
+    }
+
+    //The calling thread's event loop, runs until the coroutine stored its result in rDone
+    static void run(Loop& rLoop, const std::atomic<uint64_t>& rDone) {
+        while (rDone.load(std::memory_order_acquire) == NOT_DONE) {
+            if (void* lpHandle = rLoop.mPosted.exchange(nullptr, std::memory_order_acquire)) {
+                std::coroutine_handle<>::from_address(lpHandle).resume();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    DetachedCoroutine pushCoroutine(const uint64_t* pValues, uint64_t aCount, std::atomic<uint64_t>* pDone) {
+        uint64_t lPushed = 0;
+        for (; lPushed < aCount; ++lPushed) {
+            auto lpMessage = std::make_unique<HeapMessage>(pValues[lPushed]);
+            if (!co_await fastQueuePush(mQueue, std::move(lpMessage), scheduler(mProducerLoop))) {
+                break;
+            }
+        }
+        pDone->store(lPushed, std::memory_order_release);
+    }
+
+    template<typename Sink>
+    DetachedCoroutine popCoroutine(Sink* pSink, std::atomic<uint64_t>* pDone) {
+        uint64_t lPopped = 0;
+        if (auto lMessage = co_await fastQueuePop(mQueue, scheduler(mConsumerLoop))) {
+            (*pSink)((*lMessage)->get());
+            lPopped = 1;
+        }
+        pDone->store(lPopped, std::memory_order_release);
+    }
+
+    FastQueue<std::unique_ptr<HeapMessage>, MASK, L1_CACHE_LINE, FastQueueWait::Await> mQueue;
+    Loop mProducerLoop;
+    Loop mConsumerLoop;
+};
+
+template<uint64_t MASK> using AwaitInlineAdapter = AwaitAdapter<MASK, false>;
+template<uint64_t MASK> using AwaitLoopAdapter = AwaitAdapter<MASK, true>;
+#endif
+
+#if defined __linux || defined __APPLE__
+//The consumer sleeps in poll() on a doorbell, every sleep has to get exactly one ring
+template<uint64_t MASK>
+class DoorbellAdapter {
+public:
+    static constexpr uint64_t PRODUCERS = 1;
+    static constexpr uint64_t CONSUMERS = 1;
+    static constexpr uint64_t APIS = apiBit(Api::Blocking) | apiBit(Api::Batch);
+
+    ~DoorbellAdapter() {
+        std::unique_ptr<HeapMessage> lpMessage;
+        while (mQueue.try_pop(lpMessage)) {}
+    }
+
+    uint64_t push(uint64_t, const uint64_t* pValues, uint64_t aCount, Api aApi, const std::atomic<bool>&) {
+        if (aApi == Api::Batch) {
+            mPushItems.clear();
+            for (uint64_t i = 0; i < aCount; ++i) {
+                mPushItems.push_back(std::make_unique<HeapMessage>(pValues[i]));
+            }
+            return mQueue.push_n(mPushItems.begin(), aCount);
+        }
+        for (uint64_t i = 0; i < aCount; ++i) {
+            if (!mQueue.push(std::make_unique<HeapMessage>(pValues[i]))) {
+                return i;
+            }
+        }
+        return aCount;
+    }
+
+    template<typename Sink>
+    uint64_t pop(uint64_t, uint64_t aMax, Api aApi, Sink&& rSink) {
+        mPopItems.resize(aApi == Api::Batch ? aMax : 1);
+        while (true) {
+            uint64_t lCount = 0;
+            while (lCount < mPopItems.size() && mQueue.try_pop(mPopItems[lCount])) {
+                lCount++;
+            }
+            if (lCount) {
+                for (uint64_t i = 0; i < lCount; ++i) {
+                    rSink(mPopItems[i]->get());
+                    mPopItems[i].reset();
+                }
+                return lCount;
+            }
+            if (mQueue.isStoppedAndEmpty()) {
+                return 0;
+            }
+            if (mpDoorbell->sleep(mQueue)) {
+                mSleeps++;
+                pollfd lPoll = {mpDoorbell->fd(), POLLIN, 0};
+                while (poll(&lPoll, 1, -1) < 0) {}
+                mRings += mpDoorbell->clear();
+            }
+        }
+    }
+
+    void stop() {
+        mQueue.stopQueue();
+    }
+
+    std::string check(uint64_t) const {
+        if (!mpDoorbell) {
+            return "no doorbell";
+        }
+        if (mRings != mSleeps) {
+            return std::to_string(mRings) + " rings for " + std::to_string(mSleeps) + " sleeps";
+        }
+        return {};
+    }
+
+private:
+    FastQueue<std::unique_ptr<HeapMessage>, MASK, L1_CACHE_LINE, FastQueueWait::Await> mQueue;
+    std::unique_ptr<FastQueueDoorbell> mpDoorbell = FastQueueDoorbell::create();
+    std::vector<std::unique_ptr<HeapMessage>> mPushItems;
+    std::vector<std::unique_ptr<HeapMessage>> mPopItems;
+    uint64_t mSleeps = 0;
+    uint64_t mRings = 0;
+};
+#endif
+
+template<uint64_t MASK> using SpinAdapter = FastQueueAdapter<ValueCodec, MASK>;
+template<uint64_t MASK> using BackoffAdapter = FastQueueAdapter<ValueCodec, MASK, FastQueueWait::Backoff>;
+template<uint64_t MASK> using ParkAdapter = FastQueueAdapter<ValueCodec, MASK, FastQueueWait::Park>;
+template<uint64_t MASK> using CompactAdapter = FastQueueAdapter<ValueCodec, MASK, FastQueueWait::Spin, FastQueueCompactTraits<L1_CACHE_LINE>>;
+template<uint64_t MASK> using DeferredClearAdapter = FastQueueAdapter<ValueCodec, MASK, FastQueueWait::Spin, FastQueueDeferredClearTraits<L1_CACHE_LINE>>;
+template<uint64_t MASK> using TaggedAdapter = FastQueueAdapter<ValueCodec, MASK, FastQueueWait::Spin, FastQueueArchTraits<L1_CACHE_LINE>, FastQueueSlot::Tagged<uint64_t>>;
+template<uint64_t MASK> using SentinelAdapter = FastQueueAdapter<ValueCodec, MASK, FastQueueWait::Spin, FastQueueArchTraits<L1_CACHE_LINE>, FastQueueSlot::Sentinel<uint64_t, ~0ULL>>;
+template<uint64_t MASK> using PointerAdapter = FastQueueAdapter<PointerCodec, MASK>;
+template<uint64_t MASK> using PrefetchAdapter = FastQueueAdapter<PointerCodec, MASK, FastQueueWait::Spin, FastQueuePrefetchTraits<L1_CACHE_LINE>>;
+template<uint64_t MASK> using OwnerAdapter = FastQueueAdapter<OwnerCodec, MASK, FastQueueWait::Park>;
+template<uint64_t MASK> using StatsAdapter = FastQueueAdapter<ValueCodec, MASK, FastQueueWait::Spin, FastQueueArchTraits<L1_CACHE_LINE>, FastQueueSlot::Plain<uint64_t>, FastQueueStats::Counters>;
+template<uint64_t MASK> using StatsParkAdapter = FastQueueAdapter<ValueCodec, MASK, FastQueueWait::Park, FastQueueArchTraits<L1_CACHE_LINE>, FastQueueSlot::Plain<uint64_t>, FastQueueStats::Counters>;
+template<uint64_t MASK> using MpscParkAdapter = MpscAdapter<MASK, FastQueueWait::Park>;
+template<uint64_t MASK> using BoundedDynamicAdapter = DynamicAdapter<ValueCodec, MASK, false>;
+template<uint64_t MASK> using UnboundedDynamicAdapter = DynamicAdapter<ValueCodec, MASK, true>;
+template<uint64_t MASK> using OwnerDynamicAdapter = DynamicAdapter<OwnerCodec, MASK, true>;
+
+class JitterSource {
+public:
+    JitterSource(Jitter aJitter, uint64_t aSeed, uint64_t aMask) : mJitter(aJitter), mRandom(aSeed), mMask(aMask) {}
+
+    //Called after every push / pop call
+    void operator()() {
+        switch (mJitter) {
+            case Jitter::None:
+                return;
+            case Jitter::Random:
+                std::this_thread::sleep_for(std::chrono::nanoseconds(1 + mRandom() % 500));
+                return;
+            case Jitter::Burst:
+                if (mBurst--) {
+                    return;
+                }
+                mBurst = mRandom() % (2 * (mMask + 1)) + 1;
+                std::this_thread::sleep_for(std::chrono::microseconds(mRandom() % 200));
+                return;
+            case Jitter::Stall:
+                if (mRandom() % 4096) {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1 + mRandom() % 4));
+                return;
+        }
+    }
+
+private:
+    Jitter mJitter;
+    std::mt19937_64 mRandom;
+    uint64_t mMask;
+    uint64_t mBurst = 0;
+};
+
+//Per consumer, checks the checksum and the counter of every producer
+class Verifier {
+public:
+    explicit Verifier(uint64_t aProducers) : mNext(aProducers, 1) {}
+
+    void operator()(uint64_t aValue) {
+        mReceived++;
+        uint64_t lProducer = (aValue >> 8) & 0xff;
+        uint64_t lCounter = aValue >> 16;
+        if (valueCheck(aValue & ~0xffULL) != (aValue & 0xff) || lProducer >= mNext.size()) [[unlikely]] {
+            fail("corrupt object " + std::to_string(aValue));
+            return;
+        }
+        if (lCounter != mNext[lProducer]) [[unlikely]] {
+            fail("producer " + std::to_string(lProducer) + " object " + std::to_string(lCounter) + " expected " +
+                 std::to_string(mNext[lProducer]));
+        }
+        mNext[lProducer] = lCounter + 1;
+    }
+
+    //Objects of aProducer received in order
+    uint64_t received(uint64_t aProducer) const {
+        return mNext[aProducer] - 1;
+    }
+
+    uint64_t mReceived = 0;
+    std::string mError;
+
+private:
+    void fail(const std::string& rError) {
+        if (mError.empty()) {
+            mError = rError;
+        }
+    }
+
+    std::vector<uint64_t> mNext;
+};
+
+//An adapter with EXACT_STOP delivers every object a push reported as pushed, also when the queue is stopped from
+//another thread while the push runs. The others may lose the objects pushed during the stop in a race ending.
+template<typename Adapter>
+constexpr bool exactStop() {
+    if constexpr (requires { Adapter::EXACT_STOP; }) {
+        return Adapter::EXACT_STOP;
+    } else {
+        return false;
+    }
+}
+
+struct RunState {
+    //Set before the queue is stopped, ends the retry loops of the try / bounded pushes
+    std::atomic<bool> mStopRequested = false;
+    std::atomic<uint64_t> mActiveProducers = 0;
+    std::chrono::steady_clock::time_point mEnd;
+};
+
+template<typename Adapter>
+void stressProducer(Adapter *pQueue, const StressCase *pCase, RunState *pState, uint64_t aProducer, uint64_t *pPushed) {
+    JitterSource lJitter(pCase->mProducerJitter, pCase->mSeed * 2 + aProducer, pCase->mMask);
+    std::vector<uint64_t> lValues(pCase->mBatch);
+    uint64_t lCounter = 1;
+    while (!pState->mStopRequested && std::chrono::steady_clock::now() < pState->mEnd) {
+        for (uint64_t i = 0; i < pCase->mBatch; ++i) {
+            lValues[i] = encodeValue(aProducer, lCounter + i);
+        }
+        uint64_t lPushed = pQueue->push(aProducer, lValues.data(), pCase->mBatch, pCase->mApi, pState->mStopRequested);
+        lCounter += lPushed;
+        if (lPushed < pCase->mBatch) {
+            break;
+        }
+        lJitter();
+    }
+    *pPushed = lCounter - 1;
+    //The last producer done stops the queue
+    if (pCase->mEnding == Ending::Drain && pState->mActiveProducers.fetch_sub(1) == 1) {
+        pState->mStopRequested = true;
+        pQueue->stop();
+    }
+}
+
+template<typename Adapter>
+void stressConsumer(Adapter *pQueue, const StressCase *pCase, uint64_t aConsumer, Verifier *pVerifier) {
+    JitterSource lJitter(pCase->mConsumerJitter, pCase->mSeed * 2 + 1 + aConsumer * 1000, pCase->mMask);
+    while (pQueue->pop(aConsumer, pCase->mBatch, pCase->mApi, *pVerifier)) {
+        lJitter();
+    }
+}
+
+//Returns an empty string if the case passed
+template<typename Adapter>
+std::string runCase(const StressCase& rCase) {
+    std::string lError;
+    {
+        auto lpQueue = std::make_unique<Adapter>();
+        RunState lState;
+        lState.mActiveProducers = Adapter::PRODUCERS;
+        lState.mEnd = std::chrono::steady_clock::now() + rCase.mDuration;
+        std::vector<Verifier> lVerifiers(Adapter::CONSUMERS, Verifier(Adapter::PRODUCERS));
+        std::vector<uint64_t> lPushed(Adapter::PRODUCERS);
+        std::vector<std::thread> lThreads;
+        for (uint64_t i = 0; i < Adapter::CONSUMERS; ++i) {
+            lThreads.emplace_back(stressConsumer<Adapter>, lpQueue.get(), &rCase, i, &lVerifiers[i]);
+        }
+        for (uint64_t i = 0; i < Adapter::PRODUCERS; ++i) {
+            lThreads.emplace_back(stressProducer<Adapter>, lpQueue.get(), &rCase, &lState, i, &lPushed[i]);
+        }
+        if (rCase.mEnding == Ending::Race) {
+            lThreads.emplace_back([&lState, &lpQueue, &rCase] {
+                std::mt19937_64 lRandom(rCase.mSeed);
+                std::this_thread::sleep_for(std::chrono::microseconds(lRandom() % (rCase.mDuration.count() * 1000 + 1)));
+                lState.mStopRequested = true;
+                lpQueue->stop();
+            });
+        }
+        for (auto &rThread: lThreads) {
+            rThread.join();
+        }
+        for (auto &rVerifier: lVerifiers) {
+            if (!rVerifier.mError.empty()) {
+                return rVerifier.mError;
+            }
+            for (uint64_t i = 0; i < Adapter::PRODUCERS; ++i) {
+                bool lLost = (rCase.mEnding == Ending::Drain || exactStop<Adapter>()) && rVerifier.received(i) != lPushed[i];
+                if (lLost || rVerifier.received(i) > lPushed[i]) {
+                    return "producer " + std::to_string(i) + " pushed " + std::to_string(lPushed[i]) +
+                           " objects, received " + std::to_string(rVerifier.received(i));
+                }
+            }
+        }
+        lError = lpQueue->check(lVerifiers[0].mReceived);
+    }
+    if (lError.empty() && gLiveMessages) {
+        lError = std::to_string(gLiveMessages.load()) + " objects not deleted";
+        gLiveMessages = 0;
+    }
+    return lError;
+}
+
+//Objects left in an unbounded owning FastQueueDynamic, spread over several segments, have to be deleted by the queue
+template<uint64_t MASK>
+std::string runAbandonCase(const StressCase& rCase) {
+    {
+        FastQueueDynamic<std::unique_ptr<HeapMessage>, L1_CACHE_LINE> lQueue(MASK + 1, true);
+        std::mt19937_64 lRandom(rCase.mSeed);
+        uint64_t lPushed = (MASK + 1) * 4 + lRandom() % (MASK + 1);
+        for (uint64_t i = 0; i < lPushed; ++i) {
+            lQueue.push(std::make_unique<HeapMessage>(i + 1));
+        }
+        std::unique_ptr<HeapMessage> lpMessage;
+        for (uint64_t i = lRandom() % lPushed; i > 0; --i) {
+            lQueue.pop(lpMessage);
+        }
+    }
+    if (gLiveMessages) {
+        std::string lError = std::to_string(gLiveMessages.load()) + " objects not deleted";
+        gLiveMessages = 0;
+        return lError;
+    }
+    return {};
+}
+
+//Executor cases. Every root task spawns two children (on the worker's deque, where they may be stolen), every task has
+//to run exactly once. The dispatcher shuts the executor down itself after the duration (drain) or at a random time
+//(race), with spawns in flight either way.
+static constexpr uint64_t EXECUTOR_WORKERS = 3;
+static constexpr uint64_t EXECUTOR_MAX_ROOTS = 1 << 18;
+
+template<typename Executor>
+struct ExecutorStressTask : FastQueueTask {
+    ExecutorStressTask() {
+        mRun = run;
+    }
+    static void run(FastQueueTask* pTask) {
+        auto lpTask = static_cast<ExecutorStressTask*>(pTask);
+        lpTask->mRuns.fetch_add(1, std::memory_order_relaxed);
+        if (lpTask->mChildren) {
+            for (uint64_t i = 1; i <= 2; ++i) {
+                if (!lpTask->mpExecutor->spawn(lpTask + i)) {
+                    lpTask->mSpawnFailed = true;
+                }
+            }
+        }
+        if (lpTask->mpJitter) {
+            (*lpTask->mpJitter)();
+            lpTask->mpJitterBusy->store(false, std::memory_order_release);
+        }
+    }
+    Executor* mpExecutor = nullptr;
+    //Set by the dispatcher before submit, the task hands the jitter source back through mpJitterBusy
+    JitterSource* mpJitter = nullptr;
+    std::atomic<bool>* mpJitterBusy = nullptr;
+    bool mChildren = false;
+    bool mSpawnFailed = false;
+    std::atomic<uint32_t> mRuns = 0;
+};
+
+template<bool STEALING, uint64_t MASK>
+std::string runExecutorCase(const StressCase& rCase) {
+    using Executor = FastQueueExecutor<MASK, L1_CACHE_LINE>;
+    using Task = ExecutorStressTask<Executor>;
+    auto lpTasks = std::make_unique<Task[]>(EXECUTOR_MAX_ROOTS * 3);
+    //The consumer jitter source is not thread safe, it is handed to one task at a time (a child, so it runs wherever
+    //the child was stolen to)
+    JitterSource lConsumerJitter(rCase.mConsumerJitter, rCase.mSeed * 2 + 1, rCase.mMask);
+    JitterSource lProducerJitter(rCase.mProducerJitter, rCase.mSeed * 2, rCase.mMask);
+    std::mt19937_64 lRandom(rCase.mSeed);
+    auto lStop = std::chrono::steady_clock::now() + (rCase.mEnding == Ending::Drain ? rCase.mDuration :
+            std::chrono::microseconds(lRandom() % (rCase.mDuration.count() * 1000 + 1)));
+    uint64_t lRoots = 0;
+    {
+        Executor lExecutor(std::vector<int32_t>(EXECUTOR_WORKERS, -1), STEALING);
+        std::atomic<bool> lJitterBusy = false;
+        for (; lRoots < EXECUTOR_MAX_ROOTS && std::chrono::steady_clock::now() < lStop; ++lRoots) {
+            Task* lpRoot = &lpTasks[lRoots * 3];
+            for (uint64_t i = 0; i < 3; ++i) {
+                lpRoot[i].mpExecutor = &lExecutor;
+            }
+            lpRoot->mChildren = true;
+            if (!lJitterBusy.load(std::memory_order_acquire)) {
+                lJitterBusy.store(true, std::memory_order_relaxed);
+                lpRoot[2].mpJitter = &lConsumerJitter;
+                lpRoot[2].mpJitterBusy = &lJitterBusy;
+            }
+            if (!lExecutor.submit(lpRoot)) {
+                return "submit failed before shutdown";
+            }
+            lProducerJitter();
+        }
+        lExecutor.shutdown();
+        if (lExecutor.submit(&lpTasks[lRoots * 3 % (EXECUTOR_MAX_ROOTS * 3)])) {
+            return "submit after shutdown accepted";
+        }
+        if (lExecutor.executed() != lRoots * 3) {
+            return std::to_string(lExecutor.executed()) + " tasks executed of " + std::to_string(lRoots * 3);
+        }
+    }
+    for (uint64_t i = 0; i < EXECUTOR_MAX_ROOTS * 3; ++i) {
+        uint32_t lExpected = i < lRoots * 3 ? 1 : 0;
+        if (lpTasks[i].mRuns != lExpected || lpTasks[i].mSpawnFailed) {
+            return "task " + std::to_string(i) + " ran " + std::to_string(lpTasks[i].mRuns) + " times" +
+                   (lpTasks[i].mSpawnFailed ? ", spawn failed" : "");
+        }
+    }
+    return {};
+}
+
+using RunFunction = std::string (*)(const StressCase&);
+
+struct Variant {
+    const char* mName;
+    uint64_t mApis;
+    //Per entry in MASKS, nullptr if the variant does not support the size
+    RunFunction mRun[std::size(MASKS)];
+};
+
+template<template<uint64_t> class Adapter, uint64_t MASK, uint64_t MIN_MASK>
+RunFunction runFunction() {
+    if constexpr (MASK >= MIN_MASK) {
+        return runCase<Adapter<MASK>>;
+    } else {
+        return nullptr;
+    }
+}
+
+template<template<uint64_t> class Adapter, uint64_t MIN_MASK = 1>
+Variant variant(const char* aName) {
+    return {aName, Adapter<std::max<uint64_t>(MIN_MASK, 1)>::APIS,
+            {runFunction<Adapter, 1, MIN_MASK>(), runFunction<Adapter, 15, MIN_MASK>(), runFunction<Adapter, 1023, MIN_MASK>()}};
+}
+
+constexpr uint64_t COMPACT_MIN_MASK = 2 * FastQueueArchTraits<L1_CACHE_LINE>::SLOT_STRIDE / FastQueueCompactTraits<L1_CACHE_LINE>::SLOT_STRIDE - 1;
+
+static const Variant VARIANTS[] = {
+        variant<SpinAdapter>("fastqueue"),
+        variant<BackoffAdapter>("backoff"),
+        variant<ParkAdapter>("park"),
+        //8 slots share a cache line (16 a line pair on x86_64) and the swizzle needs two / the slots are emptied 8 at a time
+        variant<CompactAdapter, COMPACT_MIN_MASK>("compact"),
+        variant<DeferredClearAdapter, 15>("deferred-clear"),
+        variant<TaggedAdapter>("tagged"),
+        variant<SentinelAdapter>("sentinel"),
+        variant<PointerAdapter>("pointer"),
+        //Prefetches 4 slots ahead
+        variant<PrefetchAdapter, 15>("prefetch"),
+        variant<OwnerAdapter>("owned"),
+        variant<StatsAdapter>("stats"),
+        variant<StatsParkAdapter>("stats-park"),
+        variant<InlineAdapter>("inline"),
+        variant<MpscAdapter>("mpsc"),
+        variant<MpscParkAdapter>("mpsc-park"),
+        variant<BroadcastAdapter>("broadcast"),
+        variant<BoundedDynamicAdapter>("dynamic"),
+        variant<UnboundedDynamicAdapter>("dynamic-unbounded"),
+        variant<OwnerDynamicAdapter>("dynamic-owned"),
+        variant<PoolAdapter>("pool"),
+        variant<PipelineAdapter>("pipeline"),
+#if defined(__cpp_impl_coroutine)
+        variant<AwaitInlineAdapter>("await-inline"),
+        variant<AwaitLoopAdapter>("await-loop"),
+#endif
+#if defined __linux || defined __APPLE__
+        variant<DoorbellAdapter>("doorbell"),
+#endif
+        {"dynamic-abandon", apiBit(Api::Blocking), {runAbandonCase<1>, runAbandonCase<15>, runAbandonCase<1023>}},
+        {"executor-dispatch", apiBit(Api::Blocking), {runExecutorCase<false, 1>, runExecutorCase<false, 15>, runExecutorCase<false, 1023>}},
+        {"executor-stealing", apiBit(Api::Blocking), {runExecutorCase<true, 1>, runExecutorCase<true, 15>, runExecutorCase<true, 1023>}}
+};
+
+struct StressConfig {
+    std::chrono::milliseconds mDuration{100};
+    uint64_t mSeed = 0;
+    std::string mFilter;
+    bool mAllJitters = false;
+    bool mList = false;
+    bool mVerbose = false;
+};
+
+struct PlannedCase {
+    StressCase mCase;
+    RunFunction mRun;
+};
+
+std::vector<PlannedCase> planCases(const StressConfig& rConfig) {
+    std::vector<PlannedCase> lCases;
+    uint64_t lIndex = 0;
+    for (auto &rVariant: VARIANTS) {
+        for (uint64_t lSize = 0; lSize < std::size(MASKS); ++lSize) {
+            if (!rVariant.mRun[lSize]) {
+                continue;
+            }
+            for (uint64_t lApi = 0; lApi < static_cast<uint64_t>(Api::COUNT); ++lApi) {
+                if (!(rVariant.mApis & (1ULL << lApi))) {
+                    continue;
+                }
+                for (uint64_t lBatch: BATCHES) {
+                    if (!isBatchApi(static_cast<Api>(lApi)) && lBatch != 1) {
+                        continue;
+                    }
+                    for (Ending lEnding: {Ending::Drain, Ending::Race}) {
+                        for (uint64_t lJitter = 0; lJitter < std::size(JITTER_PAIRS); ++lJitter) {
+                            if (!rConfig.mAllJitters && lJitter != lIndex % std::size(JITTER_PAIRS)) {
+                                continue;
+                            }
+                            StressCase lCase;
+                            lCase.mMask = MASKS[lSize];
+                            lCase.mApi = static_cast<Api>(lApi);
+                            lCase.mBatch = lBatch;
+                            lCase.mProducerJitter = JITTER_PAIRS[lJitter].first;
+                            lCase.mConsumerJitter = JITTER_PAIRS[lJitter].second;
+                            lCase.mEnding = lEnding;
+                            lCase.mDuration = rConfig.mDuration;
+                            lCase.mName = std::string(rVariant.mName) + "/" + std::to_string(lCase.mMask + 1) + "/" + API_NAMES[lApi];
+                            if (isBatchApi(lCase.mApi)) {
+                                lCase.mName.append(":").append(std::to_string(lBatch));
+                            }
+                            lCase.mName.append("/").append(JITTER_NAMES[static_cast<int>(lCase.mProducerJitter)])
+                                    .append("-").append(JITTER_NAMES[static_cast<int>(lCase.mConsumerJitter)])
+                                    .append("/").append(lEnding == Ending::Drain ? "drain" : "race");
+                            if (lCase.mName.find(rConfig.mFilter) != std::string::npos) {
+                                lCases.push_back({lCase, rVariant.mRun[lSize]});
+                            }
+                        }
+                        lIndex++;
+                    }
+                }
+            }
+        }
+    }
+    //Seeded by the name, so --filter with the same --seed reruns a case with the jitter and stop time it failed with
+    for (uint64_t i = 0; i < lCases.size(); ++i) {
+        lCases[i].mCase.mSeed = rConfig.mSeed + std::hash<std::string>{}(lCases[i].mCase.mName);
+    }
+    return lCases;
+}
+
+//Ends the test if a case hangs
+std::atomic<int64_t> gCaseDeadline = 0;
+std::atomic<const StressCase*> gCurrentCase = nullptr;
+
+void watchdog() {
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        int64_t lDeadline = gCaseDeadline;
+        if (lDeadline && std::chrono::steady_clock::now().time_since_epoch().count() > lDeadline) {
+            std::cout << "Test failed.. " << gCurrentCase.load()->mName << " did not end (seed " << gCurrentCase.load()->mSeed << ")" << std::endl;
+            std::_Exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void printUsage(const char* aName) {
+    std::cout << "Usage: " << aName << " [options]" << std::endl
+              << "  --duration-ms N      time every case pushes (default 100)" << std::endl
+              << "  --seed N             base seed of the jitter and stop times (default random)" << std::endl
+              << "  --filter TEXT        only the cases with TEXT in the name (variant/size/api/jitter/ending)" << std::endl
+              << "  --all-jitters        every producer / consumer jitter pair for every case" << std::endl
+              << "  --list               list the cases and exit" << std::endl
+              << "  --verbose            print every case" << std::endl;
+}
+
+bool parseArguments(int argc, char** argv, StressConfig& rConfig) {
+    for (int i = 1; i < argc; ++i) {
+        std::string lOption = argv[i];
+        if (lOption == "--all-jitters") {
+            rConfig.mAllJitters = true;
+            continue;
+        }
+        if (lOption == "--list") {
+            rConfig.mList = true;
+            continue;
+        }
+        if (lOption == "--verbose") {
+            rConfig.mVerbose = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string lValue = argv[++i];
+        try {
+            if (lOption == "--duration-ms") {
+                rConfig.mDuration = std::chrono::milliseconds(std::stoull(lValue));
+            } else if (lOption == "--seed") {
+                rConfig.mSeed = std::stoull(lValue);
+            } else if (lOption == "--filter") {
+                rConfig.mFilter = lValue;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    StressConfig lConfig;
+    lConfig.mSeed = std::random_device{}();
+    if (!parseArguments(argc, argv, lConfig)) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    auto lCases = planCases(lConfig);
+    if (lConfig.mList) {
+        for (auto &rCase: lCases) {
+            std::cout << rCase.mCase.mName << std::endl;
+        }
+        return EXIT_SUCCESS;
+    }
+    std::cout << "Running " << lCases.size() << " cases of " << lConfig.mDuration.count() << " ms (seed "
+              << lConfig.mSeed << ")" << std::endl;
+    std::thread(watchdog).detach();
+    uint64_t lFailed = 0;
+    for (auto &rCase: lCases) {
+        gCurrentCase = &rCase.mCase;
+        gCaseDeadline = (std::chrono::steady_clock::now() + lConfig.mDuration + std::chrono::seconds(WATCHDOG_SEC)).time_since_epoch().count();
+        std::string lError = rCase.mRun(rCase.mCase);
+        if (!lError.empty()) {
+            lFailed++;
+            std::cout << "Test failed.. " << rCase.mCase.mName << ": " << lError << " (seed " << lConfig.mSeed << ")" << std::endl;
+        } else if (lConfig.mVerbose) {
+            std::cout << rCase.mCase.mName << " ok" << std::endl;
+        }
+    }
+    gCaseDeadline = 0;
+    std::cout << "Test ended. " << lCases.size() - lFailed << " of " << lCases.size() << " cases passed." << std::endl;
+    return lFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
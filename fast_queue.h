@@ -0,0 +1,525 @@
+//
+// Created by Anders Cedronius on 2023-06-27.
+//
+
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <bitset>
+#include <utility>
+#include <type_traits>
+#include <new>
+#include "fast_queue_arch.h"
+#include "fast_queue_wait.h"
+#include "fast_queue_slot.h"
+#include "fast_queue_stats.h"
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, typename WaitPolicy = FastQueueWait::Spin,
+        typename ArchTraits = FastQueueArchTraits<L1_CACHE_LNE>, typename SlotCarrier = FastQueueSlot::Default<T>,
+        typename Stats = FastQueueStats::None>
+class FastQueue {
+    //The unit the producer and the consumer must not share, a line pair where the adjacent line prefetcher pulls pairs
+    static constexpr uint64_t LINE_BYTES = ArchTraits::ADJACENT_LINE_PREFETCH ? 2 * ArchTraits::DESTRUCTIVE_INTERFERENCE : ArchTraits::DESTRUCTIVE_INTERFERENCE;
+    //Compact layout, more than one slot share a line (SLOT_STRIDE < LINE_BYTES)
+    static constexpr uint64_t SLOTS_PER_LINE = ArchTraits::SLOT_STRIDE < LINE_BYTES ? LINE_BYTES / ArchTraits::SLOT_STRIDE : 1;
+    static constexpr uint64_t LINES = (RING_BUFFER_SIZE + 1) / SLOTS_PER_LINE;
+    static_assert(sizeof(T) == 8, "Only 64 bit objects are supported");
+    static_assert(sizeof(void*) == 8, "The architecture is not 64-bits");
+    static_assert((RING_BUFFER_SIZE & (RING_BUFFER_SIZE + 1)) == 0, "RING_BUFFER_SIZE must be a number of contiguous bits set from LSB. Example: 0b00001111 not 0b01001111");
+    static_assert((SLOTS_PER_LINE & (SLOTS_PER_LINE - 1)) == 0 && RING_BUFFER_SIZE + 1 >= SLOTS_PER_LINE, "A compact layout needs a power of two slots per line and at least one full line");
+    static_assert(SLOTS_PER_LINE == 1 || (LINES >= 2 && (LINES & (LINES - 1)) == 0), "The compact layout swizzle needs at least two lines (line pairs on x86_64)");
+    static_assert(ArchTraits::CLEAR_BATCH >= 1 && ArchTraits::CLEAR_BATCH <= RING_BUFFER_SIZE + 1, "CLEAR_BATCH must be between 1 and the queue size");
+    static_assert(ArchTraits::PREFETCH_WRITE_AHEAD <= RING_BUFFER_SIZE && ArchTraits::PREFETCH_PAYLOAD_AHEAD <= RING_BUFFER_SIZE, "Prefetch at most RING_BUFFER_SIZE slots ahead");
+    //The slot word is the address of the object (PREFETCH_PAYLOAD_AHEAD)
+    static constexpr bool PAYLOAD_POINTER = (std::is_pointer_v<T> && std::is_same_v<SlotCarrier, FastQueueSlot::Plain<T>>) || SlotCarrier::OWNING;
+    //mExitThread while the queue is open
+    static constexpr uint64_t OPEN = UINT64_MAX;
+public:
+    FastQueue() = default;
+    FastQueue(const FastQueue&) = delete;
+    FastQueue& operator=(const FastQueue&) = delete;
+
+    //With an owning slot carrier the objects still in the queue are deleted
+    ~FastQueue() {
+        dropInFlight();
+    }
+
+    //Returns false (and the object is not pushed) if the queue is closed
+    template<typename... Args>
+    inline bool push(Args&&... args) noexcept {
+        if (isClosed()) [[unlikely]] return false;
+        uint64_t lIteration = 0;
+        while (!isSlotFree(mWritePosition.load(std::memory_order_relaxed))) {
+            if (isClosed()) [[unlikely]] return false;
+            mPushWait.wait(lIteration++, [this] { return isPushReady(); });
+        }
+        uint64_t lWritePosition;
+        if (!claim(1, lWritePosition)) [[unlikely]] return false;
+        mRingBuffer[slotIndex(lWritePosition)].mObj.store(SlotCarrier::encode(T{ std::forward<Args>(args)... }, lWritePosition), std::memory_order_release);
+        prefetchAhead(lWritePosition, 1);
+        mProducerStats.onPush(1, lIteration);
+        mPopWait.notify();
+        return true;
+    }
+
+    inline void pop(T& aOut) noexcept {
+        uint64_t lReadPosition = mReadPosition;
+        uint64_t lIteration = 0;
+        uint64_t lWord;
+        while (!SlotCarrier::isFull(lWord = mRingBuffer[slotIndex(lReadPosition)].mObj.load(std::memory_order_acquire), lReadPosition)) {
+            if (isStopped(lReadPosition)) [[unlikely]] {
+                aOut = SlotCarrier::decode(SlotCarrier::EMPTY);
+                return;
+            }
+            flushSlots();
+            mPopWait.wait(lIteration++, [this] { return isPopReady(); });
+        }
+        countPop(lReadPosition, 1, lIteration);
+        emptySlot(lReadPosition);
+        prefetchPayload(lReadPosition);
+        aOut = SlotCarrier::decode(lWord);
+    }
+
+    //Push if there is a free slot within aSpins retries. Returns false if the queue is full or closed.
+    template<typename... Args>
+    inline bool push_for(uint64_t aSpins, Args&&... args) noexcept {
+        if (isClosed()) [[unlikely]] return false;
+        const uint64_t lSpins = aSpins;
+        while (!isSlotFree(mWritePosition.load(std::memory_order_relaxed))) if (isClosed() || !aSpins--) [[unlikely]] {
+            mProducerStats.onPush(0, lSpins - aSpins);
+            return false;
+        }
+        uint64_t lWritePosition;
+        if (!claim(1, lWritePosition)) [[unlikely]] return false;
+        mRingBuffer[slotIndex(lWritePosition)].mObj.store(SlotCarrier::encode(T{ std::forward<Args>(args)... }, lWritePosition), std::memory_order_release);
+        prefetchAhead(lWritePosition, 1);
+        mProducerStats.onPush(1, lSpins - aSpins);
+        mPopWait.notify();
+        return true;
+    }
+
+    //Push if the next slot is free. Returns false if the queue is full.
+    template<typename... Args>
+    inline bool try_push(Args&&... args) noexcept {
+        return push_for(0, std::forward<Args>(args)...);
+    }
+
+    //Pop if an object arrives within aSpins retries. Returns false (and aOut = empty) if the queue is empty or stopped.
+    inline bool pop_for(T& aOut, uint64_t aSpins) noexcept {
+        uint64_t lReadPosition = mReadPosition;
+        const uint64_t lSpins = aSpins;
+        uint64_t lWord;
+        while (!SlotCarrier::isFull(lWord = mRingBuffer[slotIndex(lReadPosition)].mObj.load(std::memory_order_acquire), lReadPosition)) {
+            flushSlots();
+            if (isStopped(lReadPosition) || !aSpins--) [[unlikely]] {
+                countPop(lReadPosition, 0, lSpins - aSpins);
+                aOut = SlotCarrier::decode(SlotCarrier::EMPTY);
+                return false;
+            }
+        }
+        countPop(lReadPosition, 1, lSpins - aSpins);
+        emptySlot(lReadPosition);
+        prefetchPayload(lReadPosition);
+        aOut = SlotCarrier::decode(lWord);
+        return true;
+    }
+
+    //Pop if there is an object in the queue. Returns false (and aOut = empty) if the queue is empty.
+    inline bool try_pop(T& aOut) noexcept {
+        return pop_for(aOut, 0);
+    }
+
+    //Push, waiting for a free slot until aDeadline at the latest. With FastQueueWait::Park the producer spins for a
+    //short window and then sleeps until the consumer frees a slot, the queue is stopped or the deadline passes.
+    template<typename... Args>
+    inline FastQueueStatus push_until(std::chrono::steady_clock::time_point aDeadline, Args&&... args) noexcept {
+        if (isClosed()) [[unlikely]] return FastQueueStatus::Stopped;
+        uint64_t lIteration = 0;
+        while (!isSlotFree(mWritePosition.load(std::memory_order_relaxed))) {
+            if (isClosed()) [[unlikely]] return FastQueueStatus::Stopped;
+            if (std::chrono::steady_clock::now() >= aDeadline) {
+                mProducerStats.onPush(0, lIteration + 1);
+                return FastQueueStatus::Timeout;
+            }
+            mPushWait.waitUntil(lIteration++, aDeadline, [this] { return isPushReady(); });
+        }
+        uint64_t lWritePosition;
+        if (!claim(1, lWritePosition)) [[unlikely]] return FastQueueStatus::Stopped;
+        mRingBuffer[slotIndex(lWritePosition)].mObj.store(SlotCarrier::encode(T{ std::forward<Args>(args)... }, lWritePosition), std::memory_order_release);
+        prefetchAhead(lWritePosition, 1);
+        mProducerStats.onPush(1, lIteration);
+        mPopWait.notify();
+        return FastQueueStatus::Ok;
+    }
+
+    //Pop, waiting for an object until aDeadline at the latest (see push_until()). aOut is empty unless Ok is returned.
+    inline FastQueueStatus pop_until(T& aOut, std::chrono::steady_clock::time_point aDeadline) noexcept {
+        uint64_t lReadPosition = mReadPosition;
+        uint64_t lIteration = 0;
+        uint64_t lWord;
+        while (!SlotCarrier::isFull(lWord = mRingBuffer[slotIndex(lReadPosition)].mObj.load(std::memory_order_acquire), lReadPosition)) {
+            aOut = SlotCarrier::decode(SlotCarrier::EMPTY);
+            if (isStopped(lReadPosition)) [[unlikely]] return FastQueueStatus::Stopped;
+            flushSlots();
+            if (std::chrono::steady_clock::now() >= aDeadline) {
+                countPop(lReadPosition, 0, lIteration + 1);
+                return FastQueueStatus::Timeout;
+            }
+            mPopWait.waitUntil(lIteration++, aDeadline, [this] { return isPopReady(); });
+        }
+        countPop(lReadPosition, 1, lIteration);
+        emptySlot(lReadPosition);
+        prefetchPayload(lReadPosition);
+        aOut = SlotCarrier::decode(lWord);
+        return FastQueueStatus::Ok;
+    }
+
+    //Push aCount objects from aItems as runs of slots. Blocks until all objects are pushed or the queue is closed.
+    //Returns the number of objects pushed.
+    template<typename Iterator>
+    inline uint64_t push_n(Iterator aItems, uint64_t aCount) noexcept {
+        if (isClosed()) [[unlikely]] return 0;
+        uint64_t lPushed = 0;
+        uint64_t lIteration = 0;
+        while (lPushed < aCount) {
+            //The consumer frees slots in order, so if the last slot of the run is free all slots before it are free.
+            uint64_t lRun = std::min<uint64_t>(aCount - lPushed, RING_BUFFER_SIZE + 1);
+            while (!isSlotFree(mWritePosition.load(std::memory_order_relaxed) + lRun - 1)) {
+                if (lRun > 1) {
+                    lRun >>= 1;
+                    continue;
+                }
+                if (isClosed()) [[unlikely]] return lPushed;
+                mPushWait.wait(lIteration++, [this] { return isPushReady(); });
+            }
+            uint64_t lWritePosition;
+            if (!claim(lRun, lWritePosition)) [[unlikely]] return lPushed;
+            for (uint64_t i = 0; i < lRun; ++i) {
+                mRingBuffer[slotIndex(lWritePosition + i)].mObj.store(SlotCarrier::encode(std::move(*aItems), lWritePosition + i), std::memory_order_release);
+                ++aItems;
+            }
+            prefetchAhead(lWritePosition, lRun);
+            mProducerStats.onPush(lRun, lIteration);
+            lPushed += lRun;
+            lIteration = 0;
+            mPopWait.notify();
+        }
+        return lPushed;
+    }
+
+    //Pop up to aMax objects into aOut. Blocks until at least one object is available or the queue is stopped.
+    //Returns the number of objects popped, 0 means the queue is stopped.
+    template<typename Iterator>
+    inline uint64_t pop_n(Iterator aOut, uint64_t aMax) noexcept {
+        uint64_t lReadPosition = mReadPosition;
+        uint64_t lIteration = 0;
+        while (!SlotCarrier::isFull(mRingBuffer[slotIndex(lReadPosition)].mObj.load(std::memory_order_acquire), lReadPosition)) {
+            if (isStopped(lReadPosition)) [[unlikely]] {
+                return 0;
+            }
+            flushSlots();
+            mPopWait.wait(lIteration++, [this] { return isPopReady(); });
+        }
+        return drainRun(aMax, [&aOut](T aObj) {
+            *aOut = std::move(aObj);
+            ++aOut;
+        }, lIteration);
+    }
+
+    //Pop all objects currently in the queue passing each to aCallable. Does not block.
+    //Returns the number of objects consumed.
+    template<typename Callable>
+    inline uint64_t consume_all(Callable&& aCallable) noexcept {
+        return drainRun(RING_BUFFER_SIZE + 1, std::forward<Callable>(aCallable));
+    }
+
+    //Consumer side. Pass every object left in the queue to aCallable a run at a time until the queue is closed and
+    //empty. Returns the number of objects consumed.
+    template<typename Callable>
+    inline uint64_t drain(Callable&& aCallable) noexcept {
+        uint64_t lCount = 0;
+        uint64_t lIteration = 0;
+        while (true) {
+            if (uint64_t lRun = drainRun(RING_BUFFER_SIZE + 1, aCallable, lIteration)) {
+                lCount += lRun;
+                lIteration = 0;
+                continue;
+            }
+            if (isStopped(mReadPosition)) {
+                return lCount;
+            }
+            mPopWait.wait(lIteration++, [this] { return isPopReady(); });
+        }
+    }
+
+    //True when the queue is stopped and every object pushed before the stop is popped (Consumer side)
+    inline bool isStoppedAndEmpty() const noexcept {
+        return isStopped(mReadPosition);
+    }
+
+    //True once close() / stopQueue() is called (Maybe called from any thread)
+    inline bool isClosed() const noexcept {
+        return mExitThreadSemaphore.load(std::memory_order_relaxed);
+    }
+
+    //Producer side, with a wait policy that has arm() (FastQueueWait::Await). Arms pWaker, the consumer calls it once
+    //the next slot is free or the queue is closed. Returns false (not armed) if that already is the case.
+    inline bool armPush(FastQueueWaker* pWaker) noexcept {
+        return mPushWait.arm(pWaker, [this] { return isPushReady(); });
+    }
+
+    //Consumer side, same as armPush() for an object to pop (or the queue closed). Once armed the consumer may already
+    //run on the notifying thread, so the check uses a copy of the read position.
+    inline bool armPop(FastQueueWaker* pWaker) noexcept {
+        flushSlots();
+        uint64_t lReadPosition = mReadPosition;
+        return mPopWait.arm(pWaker, [this, lReadPosition] {
+            return SlotCarrier::isFull(mRingBuffer[slotIndex(lReadPosition)].mObj.load(std::memory_order_acquire), lReadPosition) || isClosed();
+        });
+    }
+
+    //Pull the ring into the cache of the calling side before the first object, the producer's for write. The
+    //constructor already wrote (paged in) every slot, this saves the side the cache misses of the first lap.
+    void warmPush() noexcept {
+        for (auto &rSlot: mRingBuffer) {
+            ArchTraits::prefetchWrite(&rSlot);
+        }
+    }
+
+    void warmPop() noexcept {
+        for (auto &rSlot: mRingBuffer) {
+            ArchTraits::prefetchRead(&rSlot);
+        }
+    }
+
+    //Counters of the Stats policy (all 0 with FastQueueStats::None). Maybe called from any thread, the counters are
+    //read one at a time so they may be a few objects apart.
+    FastQueueStats::Snapshot stats() const noexcept {
+        return Stats::snapshot(mProducerStats, mConsumerStats);
+    }
+
+    //Close the queue (Maybe called from any thread). Pushes fail from now on, the consumer gets the objects already
+    //pushed and then sees the queue stopped. A push racing with close() on another thread either lands before the
+    //recorded end (and is delivered) or returns false, see claim(). Only the first close() records the end.
+    void close() {
+        mExitThreadSemaphore.store(true, std::memory_order_seq_cst);
+        uint64_t lOpen = OPEN;
+        mExitThread.compare_exchange_strong(lOpen, mWritePosition.load(std::memory_order_seq_cst), std::memory_order_release, std::memory_order_relaxed);
+        mPushWait.notify();
+        mPopWait.notify();
+    }
+
+    //Stop queue (Maybe called from any thread), same as close()
+    void stopQueue() {
+        close();
+    }
+
+    //Empty the ring and open the queue again without reallocating it. Objects still in the queue are dropped (deleted
+    //with an owning slot carrier). The Stats counters start from 0 again and the wait policies are reconstructed, so
+    //a waker still armed (FastQueueWait::Await) is dropped and not called.
+    //Neither side may be inside a queue call, the threads using the queue next have to be synchronized with the
+    //caller (joined / started after or handed the queue through a mutex, atomic flag ...).
+    void reset() noexcept {
+        dropInFlight();
+        renew(mProducerStats);
+        renew(mConsumerStats);
+        renew(mPushWait);
+        renew(mPopWait);
+        for (auto &rSlot: mRingBuffer) {
+            rSlot.mObj.store(SlotCarrier::EMPTY, std::memory_order_relaxed);
+        }
+        mReadPosition = ArchTraits::FIRST_POSITION;
+        mClearPosition = ArchTraits::FIRST_POSITION;
+        mWritePosition.store(ArchTraits::FIRST_POSITION, std::memory_order_relaxed);
+        mExitThread.store(OPEN, std::memory_order_relaxed);
+        mExitThreadSemaphore.store(false, std::memory_order_release);
+    }
+
+private:
+    //Delete the objects pushed and not popped yet (owning slot carrier). Read slots not emptied yet (CLEAR_BATCH > 1)
+    //are before the read position and already belong to the consumer.
+    void dropInFlight() noexcept {
+        if constexpr (SlotCarrier::OWNING) {
+            uint64_t lWritePosition = mWritePosition.load(std::memory_order_acquire);
+            for (uint64_t lPosition = mReadPosition; lPosition != lWritePosition; ++lPosition) {
+                uint64_t lWord = mRingBuffer[slotIndex(lPosition)].mObj.load(std::memory_order_acquire);
+                if (SlotCarrier::isFull(lWord, lPosition)) {
+                    SlotCarrier::decode(lWord);
+                }
+            }
+        }
+    }
+
+    //Put a member holding atomics (not assignable) back to its initial state
+    template<typename Member>
+    static void renew(Member& rMember) noexcept {
+        rMember.~Member();
+        new(&rMember) Member();
+    }
+
+    //Consumer side. aCount objects popped at aReadPosition after aSpins failed slot checks.
+    inline void countPop(uint64_t aReadPosition, uint64_t aCount, uint64_t aSpins) noexcept {
+        if constexpr (Stats::ENABLED) {
+            mConsumerStats.onPop(aCount, aSpins, aCount ? mWritePosition.load(std::memory_order_relaxed) - aReadPosition : 0);
+        }
+    }
+
+    //Take the run of filled slots starting at the read position (at most aMax) and publish the new read position once.
+    //aSpins is the number of failed slot checks before the run (instrumentation).
+    template<typename Callable>
+    inline uint64_t drainRun(uint64_t aMax, Callable&& aCallable, uint64_t aSpins = 0) noexcept {
+        uint64_t lReadPosition = mReadPosition;
+        uint64_t lCount = 0;
+        uint64_t lWord;
+        if constexpr (ArchTraits::CLEAR_BATCH > 1) {
+            //Read but not emptied slots still look full, don't read ahead into them
+            aMax = std::min(aMax, RING_BUFFER_SIZE + 1 - (lReadPosition - mClearPosition));
+        }
+        while (lCount < aMax && SlotCarrier::isFull(lWord = mRingBuffer[slotIndex(lReadPosition + lCount)].mObj.load(std::memory_order_acquire), lReadPosition + lCount)) {
+            if constexpr (ArchTraits::CLEAR_BATCH == 1) {
+                mRingBuffer[slotIndex(lReadPosition + lCount)].mObj.store(SlotCarrier::EMPTY, std::memory_order_release);
+            }
+            prefetchPayload(lReadPosition + lCount);
+            lCount++;
+            aCallable(SlotCarrier::decode(lWord));
+        }
+        mReadPosition = lReadPosition + lCount;
+        if (lCount) {
+            countPop(lReadPosition, lCount, aSpins);
+        }
+        if constexpr (ArchTraits::CLEAR_BATCH == 1) {
+            if (lCount) {
+                mPushWait.notify();
+            }
+        } else if (lCount < aMax || mReadPosition - mClearPosition >= ArchTraits::CLEAR_BATCH) {
+            //Ran out of objects (or has a full batch), hand the slots back
+            flushSlots();
+        }
+        return lCount;
+    }
+
+    //Consumer side. The slot at aReadPosition is read. Empty it, or with CLEAR_BATCH > 1 leave it full for now and
+    //empty the read slots together once CLEAR_BATCH of them are pending. The producer never passes a full slot, so
+    //the slots have to be emptied in order and before the consumer waits (flushSlots()).
+    inline void emptySlot(uint64_t aReadPosition) noexcept {
+        mReadPosition = aReadPosition + 1;
+        if constexpr (ArchTraits::CLEAR_BATCH == 1) {
+            mRingBuffer[slotIndex(aReadPosition)].mObj.store(SlotCarrier::EMPTY, std::memory_order_release);
+            mPushWait.notify();
+        } else if (aReadPosition + 1 - mClearPosition >= ArchTraits::CLEAR_BATCH) {
+            flushSlots();
+        }
+    }
+
+    //Consumer side. Empty the read slots still pending (CLEAR_BATCH > 1), oldest first.
+    inline void flushSlots() noexcept {
+        if constexpr (ArchTraits::CLEAR_BATCH > 1) {
+            uint64_t lReadPosition = mReadPosition;
+            if (mClearPosition == lReadPosition) {
+                return;
+            }
+            for (; mClearPosition != lReadPosition; ++mClearPosition) {
+                mRingBuffer[slotIndex(mClearPosition)].mObj.store(SlotCarrier::EMPTY, std::memory_order_release);
+            }
+            mPushWait.notify();
+        }
+    }
+
+    //Producer side. aCount slots from aWritePosition are filled, keep the next PREFETCH_WRITE_AHEAD slots prefetched
+    //for write so the push finds the line exclusive.
+    inline void prefetchAhead(uint64_t aWritePosition, uint64_t aCount) noexcept {
+        if constexpr (ArchTraits::PREFETCH_WRITE_AHEAD > 0) {
+            uint64_t lEnd = aWritePosition + aCount + ArchTraits::PREFETCH_WRITE_AHEAD;
+            for (uint64_t lPosition = lEnd - std::min(aCount, ArchTraits::PREFETCH_WRITE_AHEAD); lPosition != lEnd; ++lPosition) {
+                ArchTraits::prefetchWrite(&mRingBuffer[slotIndex(lPosition)]);
+            }
+        }
+    }
+
+    //Consumer side. aReadPosition is popped, prefetch the object PREFETCH_PAYLOAD_AHEAD slots ahead if it is pushed
+    //already. A stale word (read, not emptied yet) only prefetches an old address, a prefetch never faults.
+    inline void prefetchPayload(uint64_t aReadPosition) const noexcept {
+        if constexpr (ArchTraits::PREFETCH_PAYLOAD_AHEAD > 0 && PAYLOAD_POINTER) {
+            uint64_t lPosition = aReadPosition + ArchTraits::PREFETCH_PAYLOAD_AHEAD;
+            uint64_t lWord = mRingBuffer[slotIndex(lPosition)].mObj.load(std::memory_order_relaxed);
+            if (SlotCarrier::isFull(lWord, lPosition)) {
+                ArchTraits::prefetchRead(reinterpret_cast<const void*>(lWord));
+            }
+        }
+    }
+
+    //Map a position to a slot. In the compact layout position i lives in line i % LINES at offset i / LINES
+    //so consecutive positions still touch different lines (line pairs on x86_64), LINES >= 2 is asserted above.
+    static inline uint64_t slotIndex(uint64_t aPosition) noexcept {
+        if constexpr (SLOTS_PER_LINE == 1) {
+            return aPosition & RING_BUFFER_SIZE;
+        } else {
+            return (aPosition & (LINES - 1)) * SLOTS_PER_LINE + ((aPosition / LINES) & (SLOTS_PER_LINE - 1));
+        }
+    }
+
+    //Acquire pairs with the release store of the consumer emptying the slot, so the consumer is done with it
+    inline bool isSlotFree(uint64_t aPosition) const noexcept {
+        return mRingBuffer[slotIndex(aPosition)].mObj.load(std::memory_order_acquire) == SlotCarrier::EMPTY;
+    }
+
+    //Producer side. Move the write position past aCount slots before filling them, rWritePosition is the first one.
+    //Only the producer writes the position, so this is a store and not a CAS loop. The seq_cst store and load pair
+    //with the ones in close(): either close() records the end after this claim, or the claim sees the queue closed.
+    //Then it waits for the recorded end and returns false (claim undone, nothing written) if it is not before it.
+    inline bool claim(uint64_t aCount, uint64_t& rWritePosition) noexcept {
+        uint64_t lWritePosition = mWritePosition.load(std::memory_order_relaxed);
+        mWritePosition.store(lWritePosition + aCount, std::memory_order_seq_cst);
+        if (mExitThreadSemaphore.load(std::memory_order_seq_cst)) [[unlikely]] {
+            uint64_t lExit;
+            while ((lExit = mExitThread.load(std::memory_order_acquire)) == OPEN) {
+                ArchTraits::pause();
+            }
+            if (lWritePosition >= lExit) {
+                mWritePosition.store(lWritePosition, std::memory_order_seq_cst);
+                return false;
+            }
+        }
+        rWritePosition = lWritePosition;
+        return true;
+    }
+
+    //Consumer side. Every slot before the end close() recorded is filled, no slot from it on is.
+    inline bool isStopped(uint64_t aReadPosition) const noexcept {
+        return aReadPosition >= mExitThread.load(std::memory_order_acquire);
+    }
+
+    //Wake up conditions for a parked producer / consumer
+    inline bool isPushReady() const noexcept {
+        return isSlotFree(mWritePosition.load(std::memory_order_relaxed)) || isClosed();
+    }
+
+    inline bool isPopReady() const noexcept {
+        return SlotCarrier::isFull(mRingBuffer[slotIndex(mReadPosition)].mObj.load(std::memory_order_acquire), mReadPosition) || isClosed();
+    }
+
+    //The slot holds the object encoded by SlotCarrier. Filled with a release store (the object the word points to is
+    //visible to the consumer's acquire load) and emptied with a release store (see isSlotFree()).
+    struct AlignedDataObjects {
+        alignas(ArchTraits::SLOT_STRIDE) std::atomic<uint64_t> mObj = SlotCarrier::EMPTY;
+    };
+    //Only the consumer touches the read position (and the first read slot not emptied yet, CLEAR_BATCH > 1)
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) typename ArchTraits::ReadPosition mReadPosition = ArchTraits::FIRST_POSITION;
+    uint64_t mClearPosition = ArchTraits::FIRST_POSITION;
+    typename Stats::Consumer mConsumerStats;
+    //Written by the producer, read by stopQueue()
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mWritePosition = ArchTraits::FIRST_POSITION;
+    typename Stats::Producer mProducerStats;
+    //The end recorded by close(), OPEN until then
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mExitThread = OPEN;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<bool> mExitThreadSemaphore = false;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPushWait;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPopWait;
+    //Aligned to LINE_BYTES so a line of the compact layout is a prefetched line pair
+    alignas(std::max(ArchTraits::SLOT_STRIDE, LINE_BYTES)) std::array<AlignedDataObjects, RING_BUFFER_SIZE+1> mRingBuffer;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) volatile uint8_t mBorderDown[ArchTraits::DESTRUCTIVE_INTERFERENCE]{};
+};
@@ -0,0 +1,133 @@
+//
+// Compile-time architecture traits for FastQueue
+//
+
+// The tuning decisions that used to live in two forked headers (fast_queue_x86_64.h / fast_queue_arm64.h).
+// To benchmark another tuning on a specific CPU model derive from FastQueueArchTraits and override the constants,
+// then pass it as the ArchTraits parameter of FastQueue.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if __x86_64__ || _M_X64
+#include <immintrin.h>
+
+template<uint64_t L1_CACHE_LNE = 64>
+struct FastQueueArchTraits {
+    //Objects closer than this false share
+    static constexpr uint64_t DESTRUCTIVE_INTERFERENCE = L1_CACHE_LNE;
+    //The L2 spatial prefetcher pulls cache lines in pairs, so one slot per line is not enough to keep CPU's apart
+    static constexpr bool ADJACENT_LINE_PREFETCH = true;
+    //Distance in bytes between two slots in the ring
+    static constexpr uint64_t SLOT_STRIDE = ADJACENT_LINE_PREFETCH ? L1_CACHE_LNE * 2 : L1_CACHE_LNE;
+    //The consumer empties the slots it read this many at a time, 1 empties every slot at pop
+    static constexpr uint64_t CLEAR_BATCH = 1;
+    //Position of the first object pushed
+    static constexpr uint64_t FIRST_POSITION = 0;
+    //The consumer owned read position
+    using ReadPosition = volatile uint64_t;
+    //The producer prefetches the slot this many positions ahead of the one it fills for write, 0 is off
+    static constexpr uint64_t PREFETCH_WRITE_AHEAD = 0;
+    //The consumer prefetches the object pointed to by the slot this many positions ahead of the one it pops (T a
+    //pointer or owning smart pointer), 0 is off
+    static constexpr uint64_t PREFETCH_PAYLOAD_AHEAD = 0;
+
+    static inline void pause() noexcept {
+        _mm_pause();
+    }
+
+    //PREFETCHW with -mprfchw (or a -march that has it), PREFETCHT0 without
+    static inline void prefetchWrite(const void *pAddr) noexcept {
+#ifdef _MSC_VER
+        _m_prefetchw(const_cast<void*>(pAddr));
+#else
+        __builtin_prefetch(pAddr, 1, 3);
+#endif
+    }
+
+    static inline void prefetchRead(const void *pAddr) noexcept {
+        _mm_prefetch(static_cast<const char*>(pAddr), _MM_HINT_T0);
+    }
+};
+
+#elif __aarch64__ || _M_ARM64
+
+template<uint64_t L1_CACHE_LNE = 64>
+struct FastQueueArchTraits {
+    //Objects closer than this false share
+    static constexpr uint64_t DESTRUCTIVE_INTERFERENCE = L1_CACHE_LNE;
+    //No adjacent line prefetch pairs, one slot per cache line is enough
+    static constexpr bool ADJACENT_LINE_PREFETCH = false;
+    //Distance in bytes between two slots in the ring
+    static constexpr uint64_t SLOT_STRIDE = ADJACENT_LINE_PREFETCH ? L1_CACHE_LNE * 2 : L1_CACHE_LNE;
+    //The consumer empties the slots it read this many at a time, 1 empties every slot at pop
+    static constexpr uint64_t CLEAR_BATCH = 1;
+    //Position of the first object pushed
+    static constexpr uint64_t FIRST_POSITION = 1;
+    //The consumer owned read position
+    using ReadPosition = volatile std::atomic<uint64_t>;
+    //The producer prefetches the slot this many positions ahead of the one it fills for write, 0 is off
+    static constexpr uint64_t PREFETCH_WRITE_AHEAD = 0;
+    //The consumer prefetches the object pointed to by the slot this many positions ahead of the one it pops (T a
+    //pointer or owning smart pointer), 0 is off
+    static constexpr uint64_t PREFETCH_PAYLOAD_AHEAD = 0;
+
+    static inline void pause() noexcept {
+#ifdef _MSC_VER
+        __yield();
+#else
+        asm volatile ("yield");
+#endif
+    }
+
+    //PRFM PSTL1KEEP
+    static inline void prefetchWrite(const void *pAddr) noexcept {
+#ifdef _MSC_VER
+        __prefetchw(pAddr);
+#else
+        __builtin_prefetch(pAddr, 1, 3);
+#endif
+    }
+
+    //PRFM PLDL1KEEP
+    static inline void prefetchRead(const void *pAddr) noexcept {
+#ifdef _MSC_VER
+        __prefetch(pAddr);
+#else
+        __builtin_prefetch(pAddr, 0, 3);
+#endif
+    }
+};
+
+#else
+#error Architecture not supported
+#endif
+
+//Packs 8 byte slots in every line, a cache line (8 slots, arm64) or an adjacent line prefetch pair (16 slots, x86_64).
+//FastQueue swizzles the positions so consecutive objects still land on different lines (the ring needs two lines
+//for that), at 1/8 (arm64) or 1/16 (x86_64) of the memory.
+template<uint64_t L1_CACHE_LNE = 64>
+struct FastQueueCompactTraits : FastQueueArchTraits<L1_CACHE_LNE> {
+    static constexpr uint64_t SLOT_STRIDE = 8;
+};
+
+//The consumer reads ahead and hands the slots back to the producer 8 at a time (and whenever it runs out of objects),
+//so the cache lines next to the producer are not written by the consumer on every pop.
+template<uint64_t L1_CACHE_LNE = 64>
+struct FastQueueDeferredClearTraits : FastQueueArchTraits<L1_CACHE_LNE> {
+    static constexpr uint64_t CLEAR_BATCH = 8;
+};
+
+//Prefetches the next WRITE_AHEAD slots for write on the producer side and the objects PAYLOAD_AHEAD slots ahead on
+//the consumer side. Worth it when the consumer touches a large object behind every pointer (a cold cache line per
+//object), measure with fast_queue_bench --payload vector.
+template<uint64_t L1_CACHE_LNE = 64, uint64_t WRITE_AHEAD = 4, uint64_t PAYLOAD_AHEAD = 4>
+struct FastQueuePrefetchTraits : FastQueueArchTraits<L1_CACHE_LNE> {
+    static constexpr uint64_t PREFETCH_WRITE_AHEAD = WRITE_AHEAD;
+    static constexpr uint64_t PREFETCH_PAYLOAD_AHEAD = PAYLOAD_AHEAD;
+};
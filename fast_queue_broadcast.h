@@ -0,0 +1,102 @@
+//
+// Single producer / multiple consumer fan-out built on the FastQueue slot design
+//
+
+// The producer writes every object once and each of the CONSUMERS consumers reads every object using its own read
+// position. A slot carries the position it was written for (so a consumer knows it is the object it waits for) and
+// the number of consumers that still have to read it. The producer reuses a slot when that count is 0, so slot reuse
+// is gated on the slowest consumer without any shared counter. The last reader of a slot wakes the producer.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include "fast_queue_arch.h"
+#include "fast_queue_wait.h"
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, uint64_t CONSUMERS, typename WaitPolicy = FastQueueWait::Spin,
+        typename ArchTraits = FastQueueArchTraits<L1_CACHE_LNE>>
+class FastQueueBroadcast {
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable objects can be broadcast");
+    static_assert(sizeof(T) + 2 * sizeof(uint64_t) <= ArchTraits::SLOT_STRIDE, "The object does not fit in a slot next to the sequence and reader count");
+    static_assert(CONSUMERS > 0, "At least one consumer is needed");
+    static_assert((RING_BUFFER_SIZE & (RING_BUFFER_SIZE + 1)) == 0, "RING_BUFFER_SIZE must be a number of contiguous bits set from LSB. Example: 0b00001111 not 0b01001111");
+public:
+    //Returns false (and the object is not pushed) if the queue is stopped
+    inline bool push(const T& aObj) noexcept {
+        if (isStopped()) [[unlikely]] return false;
+        uint64_t lWritePosition = mWritePosition.load(std::memory_order_relaxed);
+        auto &rSlot = mRingBuffer[lWritePosition & RING_BUFFER_SIZE];
+        uint64_t lIteration = 0;
+        while (rSlot.mPending.load(std::memory_order_acquire)) {
+            if (isStopped()) [[unlikely]] return false;
+            mPushWait.wait(lIteration++, [this, &rSlot] { return !rSlot.mPending.load(std::memory_order_acquire) || isStopped(); });
+        }
+        mWritePosition.store(lWritePosition + 1, std::memory_order_relaxed);
+        rSlot.mObj = aObj;
+        rSlot.mPending.store(CONSUMERS, std::memory_order_relaxed);
+        rSlot.mSequence.store(lWritePosition + 1, std::memory_order_release);
+        for (auto &rReader: mReaders) {
+            rReader.mWait.notify();
+        }
+        return true;
+    }
+
+    //Consumer aConsumer (0 .. CONSUMERS - 1). Returns false if the queue is stopped and this consumer has read everything.
+    inline bool pop(uint64_t aConsumer, T& aOut) noexcept {
+        auto &rReader = mReaders[aConsumer];
+        uint64_t lReadPosition = rReader.mPosition;
+        auto &rSlot = mRingBuffer[lReadPosition & RING_BUFFER_SIZE];
+        uint64_t lIteration = 0;
+        while (rSlot.mSequence.load(std::memory_order_acquire) != lReadPosition + 1) {
+            if (mExitThreadSemaphore.load(std::memory_order_acquire) && lReadPosition >= mExitThread.load(std::memory_order_relaxed)) [[unlikely]] {
+                return false;
+            }
+            rReader.mWait.wait(lIteration++, [this, &rSlot, lReadPosition] {
+                return rSlot.mSequence.load(std::memory_order_acquire) == lReadPosition + 1 || mExitThreadSemaphore.load(std::memory_order_relaxed);
+            });
+        }
+        aOut = rSlot.mObj;
+        rReader.mPosition = lReadPosition + 1;
+        if (rSlot.mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            mPushWait.notify();
+        }
+        return true;
+    }
+
+    //Stop queue (Maybe called from any thread)
+    void stopQueue() {
+        mExitThread.store(mWritePosition.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mExitThreadSemaphore.store(true, std::memory_order_release);
+        mPushWait.notify();
+        for (auto &rReader: mReaders) {
+            rReader.mWait.notify();
+        }
+    }
+
+private:
+    inline bool isStopped() const noexcept {
+        return mExitThreadSemaphore.load(std::memory_order_relaxed);
+    }
+
+    struct AlignedDataObjects {
+        alignas(ArchTraits::SLOT_STRIDE) std::atomic<uint64_t> mSequence = 0;
+        std::atomic<uint64_t> mPending = 0;
+        T mObj;
+    };
+    //Every consumer owns a cache line with its read position
+    struct alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) Reader {
+        uint64_t mPosition = 0;
+        WaitPolicy mWait;
+    };
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::array<Reader, CONSUMERS> mReaders;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mWritePosition = 0;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mExitThread = 0;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<bool> mExitThreadSemaphore = false;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPushWait;
+    alignas(std::max(ArchTraits::SLOT_STRIDE, ArchTraits::DESTRUCTIVE_INTERFERENCE)) std::array<AlignedDataObjects, RING_BUFFER_SIZE+1> mRingBuffer;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) volatile uint8_t mBorderDown[ArchTraits::DESTRUCTIVE_INTERFERENCE]{};
+};
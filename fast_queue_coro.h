@@ -0,0 +1,170 @@
+//
+// C++20 coroutine awaitables for FastQueue
+//
+
+// co_await fastQueuePop(lQueue) / co_await fastQueuePush(lQueue, lpObj) on a FastQueue with the FastQueueWait::Await
+// wait policy. When there is an object / a free slot the awaitable completes without suspending. Otherwise it arms a
+// FastQueueWaker on the queue and suspends, and the other side's next pop / push (or close()) hands the coroutine to
+// the scheduler. The default scheduler resumes it right away on the thread of the other side, inside its pop / push.
+// Pass a scheduler posting the handle to the event loop the coroutine belongs to, to resume it there. One coroutine
+// or thread per side, like the rest of FastQueue. The rest of the project is C++17, this header needs C++20.
+
+#pragma once
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error fast_queue_coro.h needs C++20 coroutines
+#endif
+
+#include <coroutine>
+#include <optional>
+#include <utility>
+#include "fast_queue.h"
+
+//Resume the coroutine on the thread that woke it
+struct FastQueueResumeInline {
+    void operator()(std::coroutine_handle<> aHandle) const {
+        aHandle.resume();
+    }
+};
+
+//A notify() that was late for an earlier object can call the waker while the side still is not ready, the waker
+//then arms again instead of handing the coroutine to the scheduler. It runs on the notifying thread, the suspended
+//side's queue state is handed over with the arm state (see FastQueueWait::Await).
+template<typename Queue, typename Scheduler>
+class FastQueueAwaiter : protected FastQueueWaker {
+protected:
+    FastQueueAwaiter(Queue& rQueue, Scheduler aScheduler) : mQueue(rQueue), mScheduler(std::move(aScheduler)) {}
+
+    Queue& mQueue;
+    Scheduler mScheduler;
+    std::coroutine_handle<> mHandle;
+};
+
+//co_await returns the object, or std::nullopt when the queue is stopped and empty
+template<typename Queue, typename T, typename Scheduler>
+class FastQueuePopAwaiter : FastQueueAwaiter<Queue, Scheduler> {
+    using Base = FastQueueAwaiter<Queue, Scheduler>;
+public:
+    FastQueuePopAwaiter(Queue& rQueue, Scheduler aScheduler) : Base(rQueue, std::move(aScheduler)) {
+        this->mWake = wake;
+    }
+
+    bool await_ready() noexcept {
+        return take();
+    }
+
+    //Nothing may touch the awaiter after a successful arm, the other side may resume the coroutine right away
+    bool await_suspend(std::coroutine_handle<> aHandle) noexcept {
+        this->mHandle = aHandle;
+        while (!this->mQueue.armPop(this)) {
+            if (take()) {
+                return false;
+            }
+            //Closed while a push still lands, see FastQueue::isStopped()
+            FastQueueArchTraits<>::pause();
+        }
+        return true;
+    }
+
+    //Woken when ready, only a push landing after close() may still be on its way
+    std::optional<T> await_resume() noexcept {
+        while (!mDone && !take()) {
+            FastQueueArchTraits<>::pause();
+        }
+        return std::move(mObj);
+    }
+
+private:
+    static void wake(FastQueueWaker* pWaker) {
+        auto lpAwaiter = static_cast<FastQueuePopAwaiter*>(pWaker);
+        if (!lpAwaiter->mQueue.armPop(lpAwaiter)) {
+            lpAwaiter->mScheduler(lpAwaiter->mHandle);
+        }
+    }
+
+    bool take() noexcept {
+        T lObj{};
+        if (this->mQueue.try_pop(lObj)) {
+            mObj = std::move(lObj);
+            mDone = true;
+        } else if (this->mQueue.isStoppedAndEmpty()) {
+            mDone = true;
+        }
+        return mDone;
+    }
+
+    std::optional<T> mObj;
+    bool mDone = false;
+};
+
+//co_await returns false if the queue is closed, the object is then left with the caller
+template<typename Queue, typename Object, typename Scheduler>
+class FastQueuePushAwaiter : FastQueueAwaiter<Queue, Scheduler> {
+    using Base = FastQueueAwaiter<Queue, Scheduler>;
+public:
+    FastQueuePushAwaiter(Queue& rQueue, Object&& rObj, Scheduler aScheduler) :
+            Base(rQueue, std::move(aScheduler)), mpObj(&rObj) {
+        this->mWake = wake;
+    }
+
+    bool await_ready() noexcept {
+        return put();
+    }
+
+    bool await_suspend(std::coroutine_handle<> aHandle) noexcept {
+        this->mHandle = aHandle;
+        while (!this->mQueue.armPush(this)) {
+            if (put()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool await_resume() noexcept {
+        while (!mDone && !put()) {
+            FastQueueArchTraits<>::pause();
+        }
+        return mPushed;
+    }
+
+private:
+    static void wake(FastQueueWaker* pWaker) {
+        auto lpAwaiter = static_cast<FastQueuePushAwaiter*>(pWaker);
+        if (!lpAwaiter->mQueue.armPush(lpAwaiter)) {
+            lpAwaiter->mScheduler(lpAwaiter->mHandle);
+        }
+    }
+
+    bool put() noexcept {
+        if (this->mQueue.try_push(std::forward<Object>(*mpObj))) {
+            mPushed = true;
+            mDone = true;
+        } else if (this->mQueue.isClosed()) {
+            mDone = true;
+        }
+        return mDone;
+    }
+
+    std::remove_reference_t<Object>* mpObj;
+    bool mPushed = false;
+    bool mDone = false;
+};
+
+//Consumer side
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, typename WaitPolicy, typename ArchTraits,
+        typename SlotCarrier, typename Stats, typename Scheduler = FastQueueResumeInline>
+auto fastQueuePop(FastQueue<T, RING_BUFFER_SIZE, L1_CACHE_LNE, WaitPolicy, ArchTraits, SlotCarrier, Stats>& rQueue,
+                  Scheduler aScheduler = {}) {
+    using Queue = FastQueue<T, RING_BUFFER_SIZE, L1_CACHE_LNE, WaitPolicy, ArchTraits, SlotCarrier, Stats>;
+    return FastQueuePopAwaiter<Queue, T, Scheduler>(rQueue, std::move(aScheduler));
+}
+
+//Producer side. rObj is moved into the queue once there is a free slot (pass a move only object with std::move()).
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, typename WaitPolicy, typename ArchTraits,
+        typename SlotCarrier, typename Stats, typename Object, typename Scheduler = FastQueueResumeInline>
+auto fastQueuePush(FastQueue<T, RING_BUFFER_SIZE, L1_CACHE_LNE, WaitPolicy, ArchTraits, SlotCarrier, Stats>& rQueue,
+                   Object&& rObj, Scheduler aScheduler = {}) {
+    using Queue = FastQueue<T, RING_BUFFER_SIZE, L1_CACHE_LNE, WaitPolicy, ArchTraits, SlotCarrier, Stats>;
+    return FastQueuePushAwaiter<Queue, Object, Scheduler>(rQueue, std::forward<Object>(rObj), std::move(aScheduler));
+}
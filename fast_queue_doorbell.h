@@ -0,0 +1,116 @@
+//
+// Event loop doorbell for FastQueue
+//
+
+// For a consumer thread blocking in epoll / kqueue instead of spinning in pop(). fd() is registered with the event
+// loop (readable), it is an eventfd on Linux and a kqueue with an EVFILT_USER event on macOS. The consumer pops until
+// the queue is empty and then calls sleep(): it arms the doorbell on the queue (FastQueueWait::Await) and returns
+// false if an object landed in the meantime, keep popping then. Once armed the next push (or close()) rings the bell
+// once and disarms it, so there is at most one write() / kevent() per sleep and none while the consumer is awake.
+// When the loop reports fd() readable clear() the bell and pop again. A late notify() can ring a bell with the queue
+// still empty, the consumer then finds nothing and sleeps again. The doorbell has to outlive an armed sleep, it
+// is armed until it rang. POSIX (Linux / macOS) only.
+//
+// while (true) {
+//     while (lQueue.try_pop(lpObj)) handle(lpObj);
+//     if (lQueue.isStoppedAndEmpty()) break;
+//     if (lpDoorbell->sleep(lQueue)) waitInEventLoop(); //The loop calls lpDoorbell->clear() when fd() is readable
+// }
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <unistd.h>
+#include "fast_queue_wait.h"
+
+#if defined __linux
+#include <sys/eventfd.h>
+#elif defined __APPLE__
+#include <sys/event.h>
+#else
+#error fast_queue_doorbell.h needs eventfd (Linux) or kqueue (macOS)
+#endif
+
+class FastQueueDoorbell : FastQueueWaker {
+public:
+    //Returns nullptr if the descriptor could not be created
+    static std::unique_ptr<FastQueueDoorbell> create() {
+#if defined __linux
+        int lFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (lFd < 0) {
+            return nullptr;
+        }
+#else
+        int lFd = kqueue();
+        if (lFd < 0) {
+            return nullptr;
+        }
+        struct kevent lEvent;
+        EV_SET(&lEvent, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+        if (kevent(lFd, &lEvent, 1, nullptr, 0, nullptr) < 0) {
+            close(lFd);
+            return nullptr;
+        }
+#endif
+        std::unique_ptr<FastQueueDoorbell> lpDoorbell(new(std::nothrow) FastQueueDoorbell(lFd));
+        if (!lpDoorbell) {
+            close(lFd);
+        }
+        return lpDoorbell;
+    }
+
+    FastQueueDoorbell(const FastQueueDoorbell&) = delete;
+    FastQueueDoorbell& operator=(const FastQueueDoorbell&) = delete;
+
+    ~FastQueueDoorbell() {
+        close(mFd);
+    }
+
+    //Register for readable with epoll / kqueue / poll
+    int fd() const noexcept {
+        return mFd;
+    }
+
+    //Consumer side, call after a failed pop on a FastQueue with the FastQueueWait::Await wait policy. Returns true if
+    //the doorbell is armed (wait for fd() to become readable), false if there is an object to pop or the queue is
+    //closed.
+    template<typename Queue>
+    bool sleep(Queue& rQueue) noexcept {
+        return rQueue.armPop(this);
+    }
+
+    //Consumer side, once fd() is readable. Returns the number of rings since the last clear() (0 or 1 with one queue).
+    uint64_t clear() noexcept {
+#if defined __linux
+        uint64_t lRings = 0;
+        return read(mFd, &lRings, sizeof(lRings)) == sizeof(lRings) ? lRings : 0;
+#else
+        struct kevent lEvent;
+        timespec lNoWait = {0, 0};
+        int lEvents = kevent(mFd, nullptr, 0, &lEvent, 1, &lNoWait);
+        return lEvents > 0 ? lEvents : 0;
+#endif
+    }
+
+private:
+    explicit FastQueueDoorbell(int aFd) : mFd(aFd) {
+        mWake = ring;
+    }
+
+    //On the thread of the notifying side
+    static void ring(FastQueueWaker* pWaker) {
+        auto lpDoorbell = static_cast<FastQueueDoorbell*>(pWaker);
+#if defined __linux
+        uint64_t lOne = 1;
+        [[maybe_unused]] ssize_t lWritten = write(lpDoorbell->mFd, &lOne, sizeof(lOne));
+#else
+        struct kevent lEvent;
+        EV_SET(&lEvent, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+        kevent(lpDoorbell->mFd, &lEvent, 1, nullptr, 0, nullptr);
+#endif
+    }
+
+    int mFd;
+};
@@ -0,0 +1,275 @@
+//
+// FastQueue with a runtime capacity and an optional unbounded (segmented) mode
+//
+
+// The ring is sized at construction (rounded up to a power of two) and allocated with a FastQueueMemoryPolicy
+// (huge pages, NUMA node, pre-fault, see fast_queue_memory.h), so the queue object itself is small. In unbounded mode
+// a producer hitting a full ring does not wait, it chains a new segment (a ring of the same size) and continues there.
+// The consumer drains the old segment, follows the chain at the position the producer switched and hands the drained
+// segment back to the producer for reuse.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <new>
+#include "fast_queue.h"
+#include "fast_queue_memory.h"
+
+template<typename T, uint64_t L1_CACHE_LNE, typename WaitPolicy = FastQueueWait::Spin,
+        typename ArchTraits = FastQueueArchTraits<L1_CACHE_LNE>, typename SlotCarrier = FastQueueSlot::Default<T>>
+class FastQueueDynamic {
+    static_assert(sizeof(T) == 8, "Only 64 bit objects are supported");
+    static_assert(ArchTraits::SLOT_STRIDE >= sizeof(uint64_t), "The slot stride must fit a slot");
+public:
+    //Spare segments kept for reuse in unbounded mode, more drained segments than this are freed
+    static constexpr uint64_t SPARE_SEGMENTS = 8;
+
+    //aSize is rounded up to a power of two. Throws std::bad_alloc if the ring can't be allocated.
+    explicit FastQueueDynamic(uint64_t aSize, bool aUnbounded = false, const FastQueueMemoryPolicy& aPolicy = {}) :
+            mMask(roundUpPowerOfTwo(aSize) - 1), mUnbounded(aUnbounded), mPolicy(aPolicy) {
+        mProducerSegment = mConsumerSegment = newSegment();
+        if (!mProducerSegment) {
+            throw std::bad_alloc();
+        }
+        mProducerSlots = mConsumerSlots = mProducerSegment->mSlots;
+    }
+
+    FastQueueDynamic(const FastQueueDynamic&) = delete;
+    FastQueueDynamic& operator=(const FastQueueDynamic&) = delete;
+
+    ~FastQueueDynamic() {
+        dropInFlight();
+        Segment* lpSegment = mConsumerSegment;
+        while (lpSegment) {
+            Segment* lpNext = lpSegment->mNext.load(std::memory_order_acquire);
+            deleteSegment(lpSegment);
+            lpSegment = lpNext;
+        }
+        while (mSpareSegments.try_pop(lpSegment)) {
+            deleteSegment(lpSegment);
+        }
+    }
+
+    //Returns false (and the object is not pushed) if the queue is stopped
+    template<typename... Args>
+    inline bool push(Args&&... args) noexcept {
+        if (mExitThreadSemaphore.load(std::memory_order_relaxed)) [[unlikely]] return false;
+        AlignedDataObjects* lpSlot = &mProducerSlots[mWritePosition.load(std::memory_order_relaxed) & mMask];
+        uint64_t lIteration = 0;
+        while (lpSlot->mObj.load(std::memory_order_acquire) != SlotCarrier::EMPTY) {
+            if (mUnbounded) {
+                if (AlignedDataObjects* lpNewSlot = grow()) {
+                    lpSlot = lpNewSlot;
+                    break;
+                }
+            }
+            if (mExitThreadSemaphore.load(std::memory_order_relaxed)) [[unlikely]] return false;
+            mPushWait.wait(lIteration++, [this] { return isPushReady(); });
+        }
+        uint64_t lWritePosition = mWritePosition.load(std::memory_order_relaxed);
+        mWritePosition.store(lWritePosition + 1, std::memory_order_relaxed);
+        lpSlot->mObj.store(SlotCarrier::encode(T{ std::forward<Args>(args)... }, lWritePosition), std::memory_order_release);
+        mPopWait.notify();
+        return true;
+    }
+
+    inline void pop(T& aOut) noexcept {
+        uint64_t lReadPosition = mReadPosition;
+        uint64_t lIteration = 0;
+        uint64_t lWord;
+        while (!SlotCarrier::isFull(lWord = mConsumerSlots[lReadPosition & mMask].mObj.load(std::memory_order_acquire), lReadPosition)) {
+            if (mUnbounded && nextSegment(lReadPosition)) {
+                continue;
+            }
+            if (isStopped(lReadPosition)) [[unlikely]] {
+                aOut = SlotCarrier::decode(SlotCarrier::EMPTY);
+                return;
+            }
+            mPopWait.wait(lIteration++, [this] { return isPopReady(); });
+        }
+        mConsumerSlots[lReadPosition & mMask].mObj.store(SlotCarrier::EMPTY, std::memory_order_release);
+        mReadPosition = lReadPosition + 1;
+        aOut = SlotCarrier::decode(lWord);
+        mPushWait.notify();
+    }
+
+    //Push if there is a free slot (or a new segment in unbounded mode). Returns false if the queue is full or stopped.
+    template<typename... Args>
+    inline bool try_push(Args&&... args) noexcept {
+        if (mExitThreadSemaphore.load(std::memory_order_relaxed)) [[unlikely]] return false;
+        AlignedDataObjects* lpSlot = &mProducerSlots[mWritePosition.load(std::memory_order_relaxed) & mMask];
+        if (lpSlot->mObj.load(std::memory_order_acquire) != SlotCarrier::EMPTY && !(mUnbounded && (lpSlot = grow()))) {
+            return false;
+        }
+        uint64_t lWritePosition = mWritePosition.load(std::memory_order_relaxed);
+        mWritePosition.store(lWritePosition + 1, std::memory_order_relaxed);
+        lpSlot->mObj.store(SlotCarrier::encode(T{ std::forward<Args>(args)... }, lWritePosition), std::memory_order_release);
+        mPopWait.notify();
+        return true;
+    }
+
+    //Pop if there is an object in the queue. Returns false (and aOut = empty) if the queue is empty.
+    inline bool try_pop(T& aOut) noexcept {
+        uint64_t lReadPosition = mReadPosition;
+        uint64_t lWord;
+        while (!SlotCarrier::isFull(lWord = mConsumerSlots[lReadPosition & mMask].mObj.load(std::memory_order_acquire), lReadPosition)) {
+            if (!(mUnbounded && nextSegment(lReadPosition))) {
+                aOut = SlotCarrier::decode(SlotCarrier::EMPTY);
+                return false;
+            }
+        }
+        mConsumerSlots[lReadPosition & mMask].mObj.store(SlotCarrier::EMPTY, std::memory_order_release);
+        mReadPosition = lReadPosition + 1;
+        aOut = SlotCarrier::decode(lWord);
+        mPushWait.notify();
+        return true;
+    }
+
+    //Slots in one segment
+    uint64_t capacity() const noexcept {
+        return mMask + 1;
+    }
+
+    //True when the queue is stopped and every object pushed before the stop is popped (Consumer side)
+    inline bool isStoppedAndEmpty() const noexcept {
+        return isStopped(mReadPosition);
+    }
+
+    //Stop queue (Maybe called from any thread)
+    void stopQueue() {
+        mExitThread.store(mWritePosition.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mExitThreadSemaphore.store(true, std::memory_order_release);
+        mPushWait.notify();
+        mPopWait.notify();
+    }
+
+private:
+    struct AlignedDataObjects {
+        alignas(ArchTraits::SLOT_STRIDE) std::atomic<uint64_t> mObj = SlotCarrier::EMPTY;
+    };
+
+    struct Segment {
+        //Set by the producer when it leaves this segment, mEnd is the first position not in this segment
+        std::atomic<Segment*> mNext = nullptr;
+        uint64_t mEnd = 0;
+        AlignedDataObjects* mSlots = nullptr;
+    };
+
+    static uint64_t roundUpPowerOfTwo(uint64_t aSize) noexcept {
+        uint64_t lSize = 1;
+        while (lSize < aSize) {
+            lSize <<= 1;
+        }
+        return lSize;
+    }
+
+    //Delete the objects pushed and not popped yet (owning slot carrier), following the chain the producer left
+    void dropInFlight() noexcept {
+        if constexpr (SlotCarrier::OWNING) {
+            Segment* lpSegment = mConsumerSegment;
+            uint64_t lWritePosition = mWritePosition.load(std::memory_order_acquire);
+            for (uint64_t lPosition = mReadPosition; lPosition != lWritePosition; ++lPosition) {
+                while (lpSegment->mNext.load(std::memory_order_acquire) && lpSegment->mEnd == lPosition) {
+                    lpSegment = lpSegment->mNext.load(std::memory_order_acquire);
+                }
+                uint64_t lWord = lpSegment->mSlots[lPosition & mMask].mObj.load(std::memory_order_acquire);
+                if (SlotCarrier::isFull(lWord, lPosition)) {
+                    SlotCarrier::decode(lWord);
+                }
+            }
+        }
+    }
+
+    uint64_t segmentBytes() const noexcept {
+        return (mMask + 1) * sizeof(AlignedDataObjects);
+    }
+
+    //Returns nullptr if out of memory
+    Segment* newSegment() noexcept {
+        auto lpSlots = static_cast<AlignedDataObjects*>(fastQueueAllocate(segmentBytes(), mPolicy));
+        if (!lpSlots) {
+            return nullptr;
+        }
+        for (uint64_t i = 0; i <= mMask; ++i) {
+            new(&lpSlots[i]) AlignedDataObjects();
+        }
+        auto lpSegment = new(std::nothrow) Segment();
+        if (!lpSegment) {
+            fastQueueFree(lpSlots, segmentBytes(), mPolicy);
+            return nullptr;
+        }
+        lpSegment->mSlots = lpSlots;
+        return lpSegment;
+    }
+
+    void deleteSegment(Segment* pSegment) noexcept {
+        fastQueueFree(pSegment->mSlots, segmentBytes(), mPolicy);
+        delete pSegment;
+    }
+
+    //Producer side. Chain a segment after the current one and return the slot for the write position in it.
+    //Returns nullptr if no segment could be allocated (then the producer waits like in bounded mode).
+    AlignedDataObjects* grow() noexcept {
+        Segment* lpNext = nullptr;
+        if (!mSpareSegments.try_pop(lpNext)) {
+            lpNext = newSegment();
+            if (!lpNext) [[unlikely]] {
+                return nullptr;
+            }
+        }
+        mProducerSegment->mEnd = mWritePosition.load(std::memory_order_relaxed);
+        mProducerSegment->mNext.store(lpNext, std::memory_order_release);
+        mProducerSegment = lpNext;
+        mProducerSlots = lpNext->mSlots;
+        return &mProducerSlots[mWritePosition.load(std::memory_order_relaxed) & mMask];
+    }
+
+    //Consumer side. Move to the next segment if the producer left the current one at aReadPosition.
+    bool nextSegment(uint64_t aReadPosition) noexcept {
+        Segment* lpNext = mConsumerSegment->mNext.load(std::memory_order_acquire);
+        if (!lpNext || mConsumerSegment->mEnd != aReadPosition) {
+            return false;
+        }
+        Segment* lpDrained = mConsumerSegment;
+        mConsumerSegment = lpNext;
+        mConsumerSlots = lpNext->mSlots;
+        lpDrained->mNext.store(nullptr, std::memory_order_relaxed);
+        lpDrained->mEnd = 0;
+        if (!mSpareSegments.try_push(lpDrained)) {
+            deleteSegment(lpDrained);
+        }
+        return true;
+    }
+
+    //Consumer side, see FastQueue::isStopped()
+    inline bool isStopped(uint64_t aReadPosition) const noexcept {
+        return mExitThreadSemaphore.load(std::memory_order_acquire) && aReadPosition >= mExitThread.load(std::memory_order_relaxed);
+    }
+
+    //Wake up conditions for a parked producer / consumer
+    inline bool isPushReady() const noexcept {
+        return mProducerSlots[mWritePosition.load(std::memory_order_relaxed) & mMask].mObj.load(std::memory_order_acquire) == SlotCarrier::EMPTY ||
+               mExitThreadSemaphore.load(std::memory_order_relaxed);
+    }
+
+    inline bool isPopReady() const noexcept {
+        return SlotCarrier::isFull(mConsumerSlots[mReadPosition & mMask].mObj.load(std::memory_order_acquire), mReadPosition) ||
+               mConsumerSegment->mNext.load(std::memory_order_acquire) || mExitThreadSemaphore.load(std::memory_order_relaxed);
+    }
+
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) const uint64_t mMask;
+    const bool mUnbounded;
+    const FastQueueMemoryPolicy mPolicy;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) typename ArchTraits::ReadPosition mReadPosition = ArchTraits::FIRST_POSITION;
+    AlignedDataObjects* mConsumerSlots = nullptr;
+    Segment* mConsumerSegment = nullptr;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mWritePosition = ArchTraits::FIRST_POSITION;
+    AlignedDataObjects* mProducerSlots = nullptr;
+    Segment* mProducerSegment = nullptr;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mExitThread = 0;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<bool> mExitThreadSemaphore = false;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPushWait;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPopWait;
+    FastQueue<Segment*, SPARE_SEGMENTS - 1, L1_CACHE_LNE> mSpareSegments;
+};
@@ -0,0 +1,334 @@
+//
+// Work-stealing executor built on FastQueue inboxes
+//
+
+// One dispatcher thread submits tasks to the workers round robin, every worker has its own FastQueue inbox so the
+// dispatcher to worker path is the plain SPSC queue. A worker moves up to REFILL tasks at a time from its inbox to its
+// own Chase-Lev deque and runs them from the bottom, an idle worker steals from the top of the other workers' deques,
+// so a worker stuck on a long task does not keep a backlog while the others spin. With stealing off the workers pop
+// their inbox directly, the hand rolled dispatcher to worker pool, to compare against.
+// Tasks are intrusive (FastQueueTask), submit() with a callable allocates one.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <type_traits>
+#include "fast_queue.h"
+#include "pin_thread.h"
+
+//The executor calls mRun(this) on a worker thread. Derive from it to carry the work.
+struct FastQueueTask {
+    void (*mRun)(FastQueueTask*) = nullptr;
+};
+
+//Chase-Lev work-stealing deque ("Correct and Efficient Work-Stealing for Weak Memory Models", Le et al. 2013) with a
+//fixed capacity of RING_BUFFER_SIZE + 1 pointers. The owner pushes and takes at the bottom, any thread steals from
+//the top. The standalone fences of the paper are seq_cst operations on the positions (same instructions on x86_64,
+//and ThreadSanitizer understands them). The positions only grow, so there is no ABA on the top CAS.
+template<typename T, uint64_t RING_BUFFER_SIZE, typename ArchTraits = FastQueueArchTraits<64>>
+class FastQueueStealDeque {
+    static_assert((RING_BUFFER_SIZE & (RING_BUFFER_SIZE + 1)) == 0, "RING_BUFFER_SIZE must be a number of contiguous bits set from LSB. Example: 0b00001111 not 0b01001111");
+public:
+    //Owner. Returns false if the deque is full.
+    inline bool push(T* pObj) noexcept {
+        int64_t lBottom = mBottom.load(std::memory_order_relaxed);
+        int64_t lTop = mTop.load(std::memory_order_acquire);
+        if (lBottom - lTop > static_cast<int64_t>(RING_BUFFER_SIZE)) {
+            return false;
+        }
+        mRingBuffer[lBottom & RING_BUFFER_SIZE].store(pObj, std::memory_order_relaxed);
+        mBottom.store(lBottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    //Owner. Returns nullptr if the deque is empty.
+    inline T* take() noexcept {
+        int64_t lBottom = mBottom.load(std::memory_order_relaxed) - 1;
+        mBottom.store(lBottom, std::memory_order_seq_cst);
+        int64_t lTop = mTop.load(std::memory_order_seq_cst);
+        if (lTop > lBottom) {
+            mBottom.store(lBottom + 1, std::memory_order_release);
+            return nullptr;
+        }
+        T* lpObj = mRingBuffer[lBottom & RING_BUFFER_SIZE].load(std::memory_order_relaxed);
+        if (lTop == lBottom) {
+            //The last object, a thief may be taking it as well
+            if (!mTop.compare_exchange_strong(lTop, lTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                lpObj = nullptr;
+            }
+            mBottom.store(lBottom + 1, std::memory_order_release);
+        }
+        return lpObj;
+    }
+
+    //Any thread. Returns nullptr if the deque is empty or another thread took the object first.
+    inline T* steal() noexcept {
+        int64_t lTop = mTop.load(std::memory_order_seq_cst);
+        int64_t lBottom = mBottom.load(std::memory_order_seq_cst);
+        if (lTop >= lBottom) {
+            return nullptr;
+        }
+        T* lpObj = mRingBuffer[lTop & RING_BUFFER_SIZE].load(std::memory_order_relaxed);
+        if (!mTop.compare_exchange_strong(lTop, lTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return lpObj;
+    }
+
+    //Racy when other threads use the deque, exact for the owner when nobody steals
+    inline bool empty() const noexcept {
+        return mTop.load(std::memory_order_acquire) >= mBottom.load(std::memory_order_acquire);
+    }
+
+private:
+    //Written by the thieves (and the owner taking the last object)
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<int64_t> mTop = 0;
+    //Written by the owner
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<int64_t> mBottom = 0;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::array<std::atomic<T*>, RING_BUFFER_SIZE + 1> mRingBuffer{};
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) volatile uint8_t mBorderDown[ArchTraits::DESTRUCTIVE_INTERFERENCE]{};
+};
+
+template<uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, typename WaitPolicy = FastQueueWait::Spin,
+        typename ArchTraits = FastQueueArchTraits<L1_CACHE_LNE>>
+class FastQueueExecutor {
+public:
+    //Tasks a worker moves from its inbox to its deque at a time
+    static constexpr uint64_t REFILL = 32;
+    //Failed rounds (own deque, inbox, one steal sweep) before an idle worker yields its CPU
+    static constexpr uint64_t IDLE_SPINS = 64;
+
+    //One worker per entry of rCpus, pinned to that CPU (-1 is not pinned). aStealing false is the plain dispatcher
+    //to worker pool.
+    explicit FastQueueExecutor(const std::vector<int32_t>& rCpus, bool aStealing = true) : mStealing(aStealing) {
+        for (uint64_t i = 0; i < std::max<uint64_t>(rCpus.size(), 1); ++i) {
+            mWorkers.push_back(std::make_unique<Worker>());
+        }
+        for (uint64_t i = 0; i < mWorkers.size(); ++i) {
+            int32_t lCpu = i < rCpus.size() ? rCpus[i] : -1;
+            mWorkers[i]->mThread = std::thread([this, i, lCpu] { workerLoop(i, lCpu); });
+        }
+    }
+
+    FastQueueExecutor(const FastQueueExecutor&) = delete;
+    FastQueueExecutor& operator=(const FastQueueExecutor&) = delete;
+
+    ~FastQueueExecutor() {
+        shutdown();
+    }
+
+    //Dispatcher side (one thread). Returns false (and the task is not run) after shutdown(). With stealing on a full
+    //inbox is skipped for the next one with room before waiting on it.
+    inline bool submit(FastQueueTask* pTask) noexcept {
+        uint64_t lWorker = mNextWorker;
+        mNextWorker = lWorker + 1 == mWorkers.size() ? 0 : lWorker + 1;
+        if (mStealing) {
+            for (uint64_t i = 0; i < mWorkers.size(); ++i) {
+                uint64_t lCandidate = lWorker + i < mWorkers.size() ? lWorker + i : lWorker + i - mWorkers.size();
+                if (mWorkers[lCandidate]->mInbox.try_push(pTask)) {
+                    return true;
+                }
+            }
+        }
+        return mWorkers[lWorker]->mInbox.push(pTask);
+    }
+
+    //Dispatcher side. Runs aCallable once on a worker, the task is allocated here and deleted after it ran.
+    template<typename Callable, typename = std::enable_if_t<!std::is_convertible_v<Callable, FastQueueTask*>>>
+    bool submit(Callable&& aCallable) {
+        auto lpTask = new CallableTask<std::decay_t<Callable>>(std::forward<Callable>(aCallable));
+        if (!submit(static_cast<FastQueueTask*>(lpTask))) {
+            delete lpTask;
+            return false;
+        }
+        return true;
+    }
+
+    //Worker side, from inside a running task. Pushes pTask to the calling worker's deque where idle workers can steal
+    //it, runs it right away if the deque is full. Returns false if not called on a worker of this executor.
+    inline bool spawn(FastQueueTask* pTask) noexcept {
+        Worker* lpWorker = tWorker;
+        if (!lpWorker || lpWorker->mExecutor != this) {
+            return false;
+        }
+        if (!lpWorker->mDeque.push(pTask)) {
+            execute(*lpWorker, pTask);
+        }
+        return true;
+    }
+
+    //Stop accepting tasks, run every task submitted or spawned so far and join the workers. Dispatcher side, a submit()
+    //on another thread at the same time may return true for a task that is never run (see FastQueue::close()).
+    void shutdown() {
+        for (auto &rWorker: mWorkers) {
+            rWorker->mInbox.stopQueue();
+        }
+        for (auto &rWorker: mWorkers) {
+            if (rWorker->mThread.joinable()) {
+                rWorker->mThread.join();
+            }
+        }
+    }
+
+    uint64_t workers() const noexcept {
+        return mWorkers.size();
+    }
+
+    //Tasks run so far / of those taken from another worker's deque (Maybe called from any thread)
+    uint64_t executed() const noexcept {
+        uint64_t lCount = 0;
+        for (auto &rWorker: mWorkers) {
+            lCount += rWorker->mExecuted.load(std::memory_order_relaxed);
+        }
+        return lCount;
+    }
+
+    uint64_t stolen() const noexcept {
+        uint64_t lCount = 0;
+        for (auto &rWorker: mWorkers) {
+            lCount += rWorker->mStolen.load(std::memory_order_relaxed);
+        }
+        return lCount;
+    }
+
+    //True if a worker could not be pinned to its CPU
+    bool pinFailed() const noexcept {
+        return mPinFailed.load(std::memory_order_relaxed);
+    }
+
+private:
+    template<typename Callable>
+    struct CallableTask : FastQueueTask {
+        explicit CallableTask(Callable&& aCallable) : mCallable(std::move(aCallable)) {
+            mRun = run;
+        }
+        explicit CallableTask(const Callable& rCallable) : mCallable(rCallable) {
+            mRun = run;
+        }
+        static void run(FastQueueTask* pTask) {
+            auto lpTask = static_cast<CallableTask*>(pTask);
+            lpTask->mCallable();
+            delete lpTask;
+        }
+        Callable mCallable;
+    };
+
+    struct Worker {
+        FastQueue<FastQueueTask*, RING_BUFFER_SIZE, L1_CACHE_LNE, WaitPolicy, ArchTraits> mInbox;
+        //Holds a refill and the tasks spawned from it
+        FastQueueStealDeque<FastQueueTask, RING_BUFFER_SIZE, ArchTraits> mDeque;
+        FastQueueExecutor* mExecutor = nullptr;
+        //Written by the worker only
+        alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mExecuted = 0;
+        std::atomic<uint64_t> mStolen = 0;
+        uint64_t mRandom = 0;
+        std::thread mThread;
+    };
+
+    inline void execute(Worker& rWorker, FastQueueTask* pTask) noexcept {
+        pTask->mRun(pTask);
+        rWorker.mExecuted.store(rWorker.mExecuted.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void workerLoop(uint64_t aIndex, int32_t aCpu) {
+        if (aCpu >= 0 && !pinThread(aCpu)) {
+            mPinFailed = true;
+        }
+        Worker& rWorker = *mWorkers[aIndex];
+        rWorker.mExecutor = this;
+        rWorker.mRandom = aIndex * 0x9E3779B97F4A7C15ULL + 1;
+        tWorker = &rWorker;
+        if (mStealing) {
+            stealingLoop(rWorker, aIndex);
+        } else {
+            //The plain pool, blocks (WaitPolicy) on the inbox
+            while (true) {
+                FastQueueTask* lpTask = rWorker.mDeque.take();
+                if (!lpTask) {
+                    rWorker.mInbox.pop(lpTask);
+                }
+                if (!lpTask) {
+                    break;
+                }
+                execute(rWorker, lpTask);
+            }
+        }
+        tWorker = nullptr;
+    }
+
+    void stealingLoop(Worker& rWorker, uint64_t aIndex) {
+        uint64_t lIdle = 0;
+        while (true) {
+            FastQueueTask* lpTask = rWorker.mDeque.take();
+            if (!lpTask) {
+                lpTask = refill(rWorker);
+            }
+            if (!lpTask) {
+                lpTask = steal(rWorker, aIndex);
+            }
+            if (lpTask) {
+                execute(rWorker, lpTask);
+                lIdle = 0;
+                continue;
+            }
+            //Nothing in the own deque or inbox and nothing to steal. The other workers finish their own tasks.
+            if (rWorker.mInbox.isStoppedAndEmpty()) {
+                return;
+            }
+            if (++lIdle < IDLE_SPINS) {
+                ArchTraits::pause();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    //Move up to REFILL tasks from the inbox to the deque, returns the first one to run now
+    inline FastQueueTask* refill(Worker& rWorker) noexcept {
+        FastQueueTask* lpFirst = nullptr;
+        if (!rWorker.mInbox.try_pop(lpFirst)) {
+            return nullptr;
+        }
+        FastQueueTask* lpTask = nullptr;
+        for (uint64_t i = 1; i < REFILL && rWorker.mInbox.try_pop(lpTask); ++i) {
+            if (!rWorker.mDeque.push(lpTask)) {
+                execute(rWorker, lpTask);
+            }
+        }
+        return lpFirst;
+    }
+
+    //One sweep over the other workers starting at a random one
+    inline FastQueueTask* steal(Worker& rWorker, uint64_t aIndex) noexcept {
+        uint64_t lWorkers = mWorkers.size();
+        //xorshift64
+        rWorker.mRandom ^= rWorker.mRandom << 13;
+        rWorker.mRandom ^= rWorker.mRandom >> 7;
+        rWorker.mRandom ^= rWorker.mRandom << 17;
+        uint64_t lStart = rWorker.mRandom % lWorkers;
+        for (uint64_t i = 0; i < lWorkers; ++i) {
+            uint64_t lVictim = (lStart + i) % lWorkers;
+            if (lVictim == aIndex) {
+                continue;
+            }
+            if (FastQueueTask* lpTask = mWorkers[lVictim]->mDeque.steal()) {
+                rWorker.mStolen.store(rWorker.mStolen.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return lpTask;
+            }
+        }
+        return nullptr;
+    }
+
+    inline static thread_local Worker* tWorker = nullptr;
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    const bool mStealing;
+    //Dispatcher only
+    uint64_t mNextWorker = 0;
+    std::atomic<bool> mPinFailed = false;
+};
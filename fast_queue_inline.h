@@ -0,0 +1,150 @@
+//
+// FastQueue variant storing the object inline in the slot
+//
+
+// Every FastQueue slot already occupies a full SLOT_STRIDE, so a small trivially copyable object (up to 56 bytes on
+// arm64 / 120 bytes on x86_64 with the default traits) fits in the slot next to an 8 byte flag. The producer copies
+// the object into the slot and publishes it with a release store of the flag, the consumer copies it out and releases
+// the slot. One cache line transfer per object and no allocator on the hot path.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include "fast_queue_arch.h"
+#include "fast_queue_wait.h"
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, typename WaitPolicy = FastQueueWait::Spin,
+        typename ArchTraits = FastQueueArchTraits<L1_CACHE_LNE>>
+class FastQueueInline {
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable objects can be stored inline");
+    static_assert(sizeof(T) + sizeof(uint64_t) <= ArchTraits::SLOT_STRIDE, "The object does not fit in a slot next to the flag");
+    static_assert((RING_BUFFER_SIZE & (RING_BUFFER_SIZE + 1)) == 0, "RING_BUFFER_SIZE must be a number of contiguous bits set from LSB. Example: 0b00001111 not 0b01001111");
+public:
+    //Returns false (and the object is not pushed) if the queue is stopped
+    inline bool push(const T& aObj) noexcept {
+        T* lpObj = reserve();
+        if (!lpObj) [[unlikely]] return false;
+        *lpObj = aObj;
+        commit();
+        return true;
+    }
+
+    //Returns false if the queue is stopped and empty
+    inline bool pop(T& aOut) noexcept {
+        const T* lpObj = front();
+        if (!lpObj) [[unlikely]] return false;
+        aOut = *lpObj;
+        release();
+        return true;
+    }
+
+    //Wait for a free slot and return it so the object can be written in place. Returns nullptr if the queue is stopped.
+    //The slot is published to the consumer by commit().
+    inline T* reserve() noexcept {
+        if (isStopped()) [[unlikely]] return nullptr;
+        uint64_t lIteration = 0;
+        while (mRingBuffer[mWritePosition.load(std::memory_order_relaxed) & RING_BUFFER_SIZE].mFull.load(std::memory_order_acquire)) {
+            if (isStopped()) [[unlikely]] return nullptr;
+            mPushWait.wait(lIteration++, [this] { return isPushReady(); });
+        }
+        //Claim the position now, stopQueue() may read the write position before commit()
+        uint64_t lWritePosition = mWritePosition.load(std::memory_order_relaxed);
+        mWritePosition.store(lWritePosition + 1, std::memory_order_relaxed);
+        mReserved = &mRingBuffer[lWritePosition & RING_BUFFER_SIZE];
+        return &mReserved->mObj;
+    }
+
+    inline void commit() noexcept {
+        mReserved->mFull.store(1, std::memory_order_release);
+        mPopWait.notify();
+    }
+
+    //Wait for the next object and return it in place. Returns nullptr if the queue is stopped and empty.
+    //The slot is handed back to the producer by release().
+    inline const T* front() noexcept {
+        uint64_t lReadPosition = mReadPosition;
+        auto &rSlot = mRingBuffer[lReadPosition & RING_BUFFER_SIZE];
+        uint64_t lIteration = 0;
+        while (!rSlot.mFull.load(std::memory_order_acquire)) {
+            if (mExitThreadSemaphore.load(std::memory_order_acquire) && lReadPosition >= mExitThread.load(std::memory_order_relaxed)) [[unlikely]] {
+                return nullptr;
+            }
+            mPopWait.wait(lIteration++, [this] { return isPopReady(); });
+        }
+        return &rSlot.mObj;
+    }
+
+    inline void release() noexcept {
+        mRingBuffer[mReadPosition & RING_BUFFER_SIZE].mFull.store(0, std::memory_order_release);
+        mReadPosition = mReadPosition + 1;
+        mPushWait.notify();
+    }
+
+    //Push if the next slot is free. Returns false if the queue is full or stopped.
+    inline bool try_push(const T& aObj) noexcept {
+        if (isStopped()) [[unlikely]] return false;
+        auto &rSlot = mRingBuffer[mWritePosition.load(std::memory_order_relaxed) & RING_BUFFER_SIZE];
+        if (rSlot.mFull.load(std::memory_order_acquire)) {
+            return false;
+        }
+        mWritePosition.store(mWritePosition.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        rSlot.mObj = aObj;
+        rSlot.mFull.store(1, std::memory_order_release);
+        mPopWait.notify();
+        return true;
+    }
+
+    //Pop if there is an object in the queue. Returns false if the queue is empty.
+    inline bool try_pop(T& aOut) noexcept {
+        auto &rSlot = mRingBuffer[mReadPosition & RING_BUFFER_SIZE];
+        if (!rSlot.mFull.load(std::memory_order_acquire)) {
+            return false;
+        }
+        aOut = rSlot.mObj;
+        rSlot.mFull.store(0, std::memory_order_release);
+        mReadPosition = mReadPosition + 1;
+        mPushWait.notify();
+        return true;
+    }
+
+    //Stop queue (Maybe called from any thread)
+    void stopQueue() {
+        mExitThread.store(mWritePosition.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mExitThreadSemaphore.store(true, std::memory_order_release);
+        mPushWait.notify();
+        mPopWait.notify();
+    }
+
+private:
+    //Producer side, pushes fail once stopQueue() is called
+    inline bool isStopped() const noexcept {
+        return mExitThreadSemaphore.load(std::memory_order_relaxed);
+    }
+
+    //Wake up conditions for a parked producer / consumer
+    inline bool isPushReady() const noexcept {
+        return !mRingBuffer[mWritePosition.load(std::memory_order_relaxed) & RING_BUFFER_SIZE].mFull.load(std::memory_order_acquire) || isStopped();
+    }
+
+    inline bool isPopReady() const noexcept {
+        return mRingBuffer[mReadPosition & RING_BUFFER_SIZE].mFull.load(std::memory_order_acquire) || mExitThreadSemaphore.load(std::memory_order_relaxed);
+    }
+
+    struct AlignedDataObjects {
+        alignas(ArchTraits::SLOT_STRIDE) std::atomic<uint64_t> mFull = 0;
+        T mObj;
+    };
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) typename ArchTraits::ReadPosition mReadPosition = ArchTraits::FIRST_POSITION;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mWritePosition = ArchTraits::FIRST_POSITION;
+    AlignedDataObjects* mReserved = nullptr;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mExitThread = 0;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<bool> mExitThreadSemaphore = false;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPushWait;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPopWait;
+    alignas(std::max(ArchTraits::SLOT_STRIDE, ArchTraits::DESTRUCTIVE_INTERFERENCE)) std::array<AlignedDataObjects, RING_BUFFER_SIZE+1> mRingBuffer;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) volatile uint8_t mBorderDown[ArchTraits::DESTRUCTIVE_INTERFERENCE]{};
+};
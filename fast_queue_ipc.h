@@ -0,0 +1,317 @@
+//
+// FastQueue between two processes over shared memory
+//
+
+// The whole queue (header, positions, exit flags and slots) lives in one shm_open() / memfd_create() region and
+// refers to nothing by pointer, so it can be mapped at any address in each process. Objects are stored inline in the
+// slots like FastQueueInline. The creator writes a header (magic, version and the layout parameters) last, the other
+// side only attaches to a region with a matching header. Each side records its pid, a side waiting on a full / empty
+// queue checks now and then if the other process is still alive, so a crashed peer ends the queue like stopQueue().
+// Use FastQueueWait::ParkShared (Park and Await are rejected) to sleep between the processes. POSIX (Linux / macOS) only.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fast_queue_arch.h"
+#include "fast_queue_wait.h"
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, typename WaitPolicy = FastQueueWait::Spin,
+        typename ArchTraits = FastQueueArchTraits<L1_CACHE_LNE>>
+class FastQueueIpc {
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable objects can be passed between processes");
+    static_assert(sizeof(T) + sizeof(uint64_t) <= ArchTraits::SLOT_STRIDE, "The object does not fit in a slot next to the flag");
+    static_assert((RING_BUFFER_SIZE & (RING_BUFFER_SIZE + 1)) == 0, "RING_BUFFER_SIZE must be a number of contiguous bits set from LSB. Example: 0b00001111 not 0b01001111");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory needs address free atomics");
+    static_assert(WaitPolicy::PROCESS_SHARED, "A process private wait policy (Park, Await) never wakes the other process, use Spin, Pause, Backoff or ParkShared");
+public:
+    static constexpr uint32_t MAGIC = 0x46514950; //FQIP
+    static constexpr uint32_t VERSION = 1;
+    //A waiting side checks the other process every PEER_CHECK_ROUNDS failed slot checks
+    static constexpr uint64_t PEER_CHECK_ROUNDS = 256;
+
+    enum class Side {
+        Producer,
+        Consumer
+    };
+
+    //Create the shared memory object aName ("/name"), replacing an old one, and attach as aSide.
+    //The object is unlinked when the returned queue is destroyed. Returns nullptr on failure.
+    static std::unique_ptr<FastQueueIpc> create(const char* aName, Side aSide) {
+        shm_unlink(aName);
+        int lFd = shm_open(aName, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (lFd < 0) {
+            return nullptr;
+        }
+        auto lQueue = attach(lFd, aSide, true);
+        close(lFd);
+        if (!lQueue) {
+            shm_unlink(aName);
+            return nullptr;
+        }
+        lQueue->mName = aName;
+        return lQueue;
+    }
+
+    //Attach as aSide to the queue created under aName. Returns nullptr if it does not exist (yet), is not
+    //initialized yet or was created with another T / size / layout.
+    static std::unique_ptr<FastQueueIpc> open(const char* aName, Side aSide) {
+        int lFd = shm_open(aName, O_RDWR, 0600);
+        if (lFd < 0) {
+            return nullptr;
+        }
+        auto lQueue = attach(lFd, aSide, false);
+        close(lFd);
+        return lQueue;
+    }
+
+    //Same on a descriptor the caller owns (memfd_create() passed over a unix socket or inherited over fork())
+    static std::unique_ptr<FastQueueIpc> create(int aFd, Side aSide) {
+        return attach(aFd, aSide, true);
+    }
+
+    static std::unique_ptr<FastQueueIpc> open(int aFd, Side aSide) {
+        return attach(aFd, aSide, false);
+    }
+
+    FastQueueIpc(const FastQueueIpc&) = delete;
+    FastQueueIpc& operator=(const FastQueueIpc&) = delete;
+
+    //Detaching counts as leaving for the other side, it will see the queue as stopped once it is drained
+    ~FastQueueIpc() {
+        if (!mpShared) {
+            //attach() failed, nothing mapped
+            return;
+        }
+        mpShared->mHeader.mPid[static_cast<int>(mSide)].store(-1, std::memory_order_release);
+        mpShared->mPushWait.notify();
+        mpShared->mPopWait.notify();
+        munmap(mpShared, sizeof(Shared));
+        if (!mName.empty()) {
+            shm_unlink(mName.c_str());
+        }
+    }
+
+    //Returns false (and the object is not pushed) if the queue is stopped or the consumer is gone, see reserve()
+    inline bool push(const T& aObj) noexcept {
+        T* lpObj = reserve();
+        if (!lpObj) [[unlikely]] return false;
+        *lpObj = aObj;
+        commit();
+        return true;
+    }
+
+    //Returns false if the queue is stopped (or the producer is gone) and empty
+    inline bool pop(T& aOut) noexcept {
+        const T* lpObj = front();
+        if (!lpObj) [[unlikely]] return false;
+        aOut = *lpObj;
+        release();
+        return true;
+    }
+
+    //Wait for a free slot and return it so the object can be written in place. Returns nullptr if the queue is stopped
+    //or the consumer has detached, a consumer process that died without detaching is noticed while waiting on a full
+    //queue. The slot is published to the consumer by commit().
+    inline T* reserve() noexcept {
+        Shared& rShared = *mpShared;
+        if (rShared.mExitThreadSemaphore.load(std::memory_order_acquire) || isPeerDetached()) [[unlikely]] return nullptr;
+        uint64_t lIteration = 0;
+        while (rShared.mRingBuffer[rShared.mWritePosition.load(std::memory_order_relaxed) & RING_BUFFER_SIZE].mFull.load(std::memory_order_acquire)) {
+            if (rShared.mExitThreadSemaphore.load(std::memory_order_acquire)) [[unlikely]] return nullptr;
+            if (++lIteration % PEER_CHECK_ROUNDS == 0 && !isPeerAlive()) [[unlikely]] return nullptr;
+            rShared.mPushWait.wait(lIteration, [this] { return isPushReady(); });
+        }
+        //Claim the position now, stopQueue() may read the write position before commit()
+        uint64_t lWritePosition = rShared.mWritePosition.load(std::memory_order_relaxed);
+        rShared.mWritePosition.store(lWritePosition + 1, std::memory_order_relaxed);
+        mReserved = &rShared.mRingBuffer[lWritePosition & RING_BUFFER_SIZE];
+        return &mReserved->mObj;
+    }
+
+    inline void commit() noexcept {
+        mReserved->mFull.store(1, std::memory_order_release);
+        mpShared->mPopWait.notify();
+    }
+
+    //Wait for the next object and return it in place. Returns nullptr if the queue is stopped (or the producer is gone)
+    //and empty. The slot is handed back to the producer by release().
+    inline const T* front() noexcept {
+        Shared& rShared = *mpShared;
+        uint64_t lReadPosition = rShared.mReadPosition.load(std::memory_order_relaxed);
+        auto &rSlot = rShared.mRingBuffer[lReadPosition & RING_BUFFER_SIZE];
+        uint64_t lIteration = 0;
+        while (!rSlot.mFull.load(std::memory_order_acquire)) {
+            if (rShared.mExitThreadSemaphore.load(std::memory_order_acquire) &&
+                lReadPosition >= rShared.mExitThread.load(std::memory_order_relaxed)) [[unlikely]] {
+                return nullptr;
+            }
+            //A producer that died between reserve() and commit() leaves an empty slot, so check the slot once more
+            if (++lIteration % PEER_CHECK_ROUNDS == 0 && !isPeerAlive()) [[unlikely]] {
+                return rSlot.mFull.load(std::memory_order_acquire) ? &rSlot.mObj : nullptr;
+            }
+            rShared.mPopWait.wait(lIteration, [this] { return isPopReady(); });
+        }
+        return &rSlot.mObj;
+    }
+
+    inline void release() noexcept {
+        Shared& rShared = *mpShared;
+        uint64_t lReadPosition = rShared.mReadPosition.load(std::memory_order_relaxed);
+        rShared.mRingBuffer[lReadPosition & RING_BUFFER_SIZE].mFull.store(0, std::memory_order_release);
+        rShared.mReadPosition.store(lReadPosition + 1, std::memory_order_relaxed);
+        rShared.mPushWait.notify();
+    }
+
+    //Push if the next slot is free. Returns false if the queue is full, stopped or the consumer has detached.
+    inline bool try_push(const T& aObj) noexcept {
+        Shared& rShared = *mpShared;
+        if (rShared.mExitThreadSemaphore.load(std::memory_order_acquire) || isPeerDetached()) [[unlikely]] return false;
+        auto &rSlot = rShared.mRingBuffer[rShared.mWritePosition.load(std::memory_order_relaxed) & RING_BUFFER_SIZE];
+        if (rSlot.mFull.load(std::memory_order_acquire)) {
+            return false;
+        }
+        rShared.mWritePosition.store(rShared.mWritePosition.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        rSlot.mObj = aObj;
+        rSlot.mFull.store(1, std::memory_order_release);
+        rShared.mPopWait.notify();
+        return true;
+    }
+
+    //Pop if there is an object in the queue. Returns false if the queue is empty.
+    inline bool try_pop(T& aOut) noexcept {
+        Shared& rShared = *mpShared;
+        uint64_t lReadPosition = rShared.mReadPosition.load(std::memory_order_relaxed);
+        auto &rSlot = rShared.mRingBuffer[lReadPosition & RING_BUFFER_SIZE];
+        if (!rSlot.mFull.load(std::memory_order_acquire)) {
+            return false;
+        }
+        aOut = rSlot.mObj;
+        rSlot.mFull.store(0, std::memory_order_release);
+        rShared.mReadPosition.store(lReadPosition + 1, std::memory_order_relaxed);
+        rShared.mPushWait.notify();
+        return true;
+    }
+
+    //False if the other side has detached or its process is gone. True while the other side has not attached yet.
+    //An exited child that is not reaped yet still counts as alive, so a parent has to wait() for it / ignore SIGCHLD.
+    bool isPeerAlive() const noexcept {
+        int32_t lPid = mpShared->mHeader.mPid[1 - static_cast<int>(mSide)].load(std::memory_order_acquire);
+        if (lPid == 0) {
+            return true;
+        }
+        return lPid > 0 && (kill(lPid, 0) == 0 || errno == EPERM);
+    }
+
+    //Stop queue (Maybe called from any thread in either process)
+    void stopQueue() {
+        mpShared->mExitThread.store(mpShared->mWritePosition.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mpShared->mExitThreadSemaphore.store(true, std::memory_order_release);
+        mpShared->mPushWait.notify();
+        mpShared->mPopWait.notify();
+    }
+
+private:
+    struct AlignedDataObjects {
+        alignas(ArchTraits::SLOT_STRIDE) std::atomic<uint64_t> mFull = 0;
+        T mObj;
+    };
+
+    struct Header {
+        std::atomic<uint32_t> mMagic = 0;
+        uint32_t mVersion = VERSION;
+        uint32_t mObjectSize = sizeof(T);
+        uint32_t mSlotStride = ArchTraits::SLOT_STRIDE;
+        uint64_t mRingSize = RING_BUFFER_SIZE + 1;
+        uint64_t mRegionSize = 0;
+        //Indexed by Side. 0 not attached yet, -1 detached.
+        std::atomic<int32_t> mPid[2] = {};
+    };
+
+    //The shared region. Fixed offsets and no pointers, every process maps it where it likes.
+    struct Shared {
+        alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) Header mHeader;
+        alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mReadPosition = ArchTraits::FIRST_POSITION;
+        alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mWritePosition = ArchTraits::FIRST_POSITION;
+        alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mExitThread = 0;
+        alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<bool> mExitThreadSemaphore = false;
+        alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPushWait;
+        alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPopWait;
+        alignas(std::max(ArchTraits::SLOT_STRIDE, ArchTraits::DESTRUCTIVE_INTERFERENCE)) std::array<AlignedDataObjects, RING_BUFFER_SIZE+1> mRingBuffer;
+        alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) volatile uint8_t mBorderDown[ArchTraits::DESTRUCTIVE_INTERFERENCE]{};
+    };
+
+    FastQueueIpc(Shared* pShared, Side aSide) : mpShared(pShared), mSide(aSide) {}
+
+    static std::unique_ptr<FastQueueIpc> attach(int aFd, Side aSide, bool aCreate) {
+        if (aCreate && ftruncate(aFd, sizeof(Shared))) {
+            return nullptr;
+        }
+        struct stat lStat = {};
+        if (fstat(aFd, &lStat) || static_cast<uint64_t>(lStat.st_size) < sizeof(Shared)) {
+            return nullptr;
+        }
+        void* lpMemory = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED, aFd, 0);
+        if (lpMemory == MAP_FAILED) {
+            return nullptr;
+        }
+        //Before the region is initialized or the pid recorded, so a failed allocation leaves it as it was
+        std::unique_ptr<FastQueueIpc> lpQueue(new(std::nothrow) FastQueueIpc(nullptr, aSide));
+        if (!lpQueue) {
+            munmap(lpMemory, sizeof(Shared));
+            return nullptr;
+        }
+        Shared* lpShared = nullptr;
+        if (aCreate) {
+            lpShared = new(lpMemory) Shared();
+            lpShared->mHeader.mRegionSize = sizeof(Shared);
+            //Publish the header last, the other side does not touch the region before it sees the magic
+            lpShared->mHeader.mMagic.store(MAGIC, std::memory_order_release);
+        } else {
+            lpShared = static_cast<Shared*>(lpMemory);
+            const Header& rHeader = lpShared->mHeader;
+            if (rHeader.mMagic.load(std::memory_order_acquire) != MAGIC || rHeader.mVersion != VERSION ||
+                rHeader.mObjectSize != sizeof(T) || rHeader.mSlotStride != ArchTraits::SLOT_STRIDE ||
+                rHeader.mRingSize != RING_BUFFER_SIZE + 1 || rHeader.mRegionSize != sizeof(Shared)) {
+                munmap(lpMemory, sizeof(Shared));
+                return nullptr;
+            }
+        }
+        lpShared->mHeader.mPid[static_cast<int>(aSide)].store(getpid(), std::memory_order_release);
+        lpQueue->mpShared = lpShared;
+        return lpQueue;
+    }
+
+    //The other side detached (destroyed its queue), a single load unlike isPeerAlive()
+    inline bool isPeerDetached() const noexcept {
+        return mpShared->mHeader.mPid[1 - static_cast<int>(mSide)].load(std::memory_order_acquire) < 0;
+    }
+
+    //Wake up conditions for a parked producer / consumer
+    inline bool isPushReady() const noexcept {
+        return !mpShared->mRingBuffer[mpShared->mWritePosition.load(std::memory_order_relaxed) & RING_BUFFER_SIZE].mFull.load(std::memory_order_acquire) ||
+               mpShared->mExitThreadSemaphore.load(std::memory_order_acquire);
+    }
+
+    inline bool isPopReady() const noexcept {
+        return mpShared->mRingBuffer[mpShared->mReadPosition.load(std::memory_order_relaxed) & RING_BUFFER_SIZE].mFull.load(std::memory_order_acquire) ||
+               mpShared->mExitThreadSemaphore.load(std::memory_order_acquire);
+    }
+
+    Shared* mpShared = nullptr;
+    const Side mSide;
+    std::string mName;
+    AlignedDataObjects* mReserved = nullptr;
+};
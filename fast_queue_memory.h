@@ -0,0 +1,136 @@
+//
+// Ring storage allocation for FastQueue
+//
+
+// On Linux the storage is mmap'ed so it can be backed by huge pages (MAP_HUGETLB, falling back to
+// madvise(MADV_HUGEPAGE) on a 2 MiB aligned region), bound to a NUMA node with mbind() and pre-faulted after the bind
+// so every page lands on that node. Use cpuNumaNode() from pin_thread.h to place a queue next to its consumer.
+// Other OS's get aligned heap memory, the huge page / NUMA options are ignored there.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#if defined __linux
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#elif defined _WIN64
+#include <malloc.h>
+#endif
+
+//Rings this size and larger are aligned to a (2 MiB) huge page, smaller ones to a normal page
+static constexpr uint64_t FAST_QUEUE_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+static constexpr uint64_t FAST_QUEUE_PAGE_SIZE = 4096;
+
+struct FastQueueMemoryPolicy {
+    //Back the storage with huge pages
+    bool mHugePages = false;
+    //Bind the storage to this NUMA node, -1 leaves it to first touch
+    int32_t mNumaNode = -1;
+    //Touch every page at allocation so the hot path never takes a page fault
+    bool mPreFault = false;
+};
+
+inline uint64_t fastQueueStorageAlignment(uint64_t aBytes, const FastQueueMemoryPolicy& aPolicy) noexcept {
+    return (aPolicy.mHugePages || aBytes >= FAST_QUEUE_HUGE_PAGE_SIZE) ? FAST_QUEUE_HUGE_PAGE_SIZE : FAST_QUEUE_PAGE_SIZE;
+}
+
+inline uint64_t fastQueueStorageSize(uint64_t aBytes, const FastQueueMemoryPolicy& aPolicy) noexcept {
+    uint64_t lAlignment = fastQueueStorageAlignment(aBytes, aPolicy);
+    return (aBytes + lAlignment - 1) & ~(lAlignment - 1);
+}
+
+//Returns zeroed memory or nullptr on failure
+inline void* fastQueueAllocate(uint64_t aBytes, const FastQueueMemoryPolicy& aPolicy = {}) noexcept {
+    uint64_t lAlignment = fastQueueStorageAlignment(aBytes, aPolicy);
+    uint64_t lBytes = fastQueueStorageSize(aBytes, aPolicy);
+#if defined __linux
+    void* lpMemory = MAP_FAILED;
+    if (aPolicy.mHugePages) {
+        lpMemory = mmap(nullptr, lBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (lpMemory == MAP_FAILED) {
+        //No reserved huge pages. Over map and trim to get an aligned region transparent huge pages can back.
+        uint64_t lMapped = lBytes + lAlignment;
+        auto lpRaw = static_cast<uint8_t*>(mmap(nullptr, lMapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (lpRaw == MAP_FAILED) {
+            return nullptr;
+        }
+        auto lpAligned = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(lpRaw) + lAlignment - 1) & ~(lAlignment - 1));
+        if (lpAligned > lpRaw) {
+            munmap(lpRaw, lpAligned - lpRaw);
+        }
+        if (lpRaw + lMapped > lpAligned + lBytes) {
+            munmap(lpAligned + lBytes, (lpRaw + lMapped) - (lpAligned + lBytes));
+        }
+        lpMemory = lpAligned;
+        if (aPolicy.mHugePages) {
+            madvise(lpMemory, lBytes, MADV_HUGEPAGE);
+        }
+    }
+    if (aPolicy.mNumaNode >= 0 && aPolicy.mNumaNode < 1024) {
+        unsigned long lNodeMask[1024 / (8 * sizeof(unsigned long))] = {};
+        lNodeMask[aPolicy.mNumaNode / (8 * sizeof(unsigned long))] |= 1UL << (aPolicy.mNumaNode % (8 * sizeof(unsigned long)));
+        //Best effort, a failing bind leaves the memory to first touch
+        syscall(SYS_mbind, lpMemory, lBytes, MPOL_BIND, lNodeMask, 1024, 0);
+    }
+#elif defined _WIN64
+    void* lpMemory = _aligned_malloc(lBytes, lAlignment);
+    if (!lpMemory) {
+        return nullptr;
+    }
+    std::memset(lpMemory, 0, lBytes);
+#else
+    void* lpMemory = std::aligned_alloc(lAlignment, lBytes);
+    if (!lpMemory) {
+        return nullptr;
+    }
+    std::memset(lpMemory, 0, lBytes);
+#endif
+    if (aPolicy.mPreFault) {
+        for (uint64_t i = 0; i < lBytes; i += FAST_QUEUE_PAGE_SIZE) {
+            static_cast<volatile uint8_t*>(lpMemory)[i] = 0;
+        }
+    }
+    return lpMemory;
+}
+
+//aBytes and aPolicy must be the ones the memory was allocated with
+inline void fastQueueFree(void* pMemory, uint64_t aBytes, const FastQueueMemoryPolicy& aPolicy = {}) noexcept {
+    if (!pMemory) {
+        return;
+    }
+#if defined __linux
+    munmap(pMemory, fastQueueStorageSize(aBytes, aPolicy));
+#elif defined _WIN64
+    _aligned_free(pMemory);
+#else
+    std::free(pMemory);
+#endif
+}
+
+//Construct a fixed size queue (FastQueue, FastQueueInline ...) in memory allocated with aPolicy.
+//Returns nullptr if out of memory. Destroy with fastQueueDestroy().
+template<typename Q, typename... Args>
+Q* fastQueueCreate(const FastQueueMemoryPolicy& aPolicy, Args&&... args) {
+    void* lpMemory = fastQueueAllocate(sizeof(Q), aPolicy);
+    if (!lpMemory) {
+        return nullptr;
+    }
+    return new(lpMemory) Q(std::forward<Args>(args)...);
+}
+
+template<typename Q>
+void fastQueueDestroy(Q* pQueue, const FastQueueMemoryPolicy& aPolicy) noexcept {
+    if (!pQueue) {
+        return;
+    }
+    pQueue->~Q();
+    fastQueueFree(pQueue, sizeof(Q), aPolicy);
+}
@@ -0,0 +1,184 @@
+//
+// Multi producer single consumer front-end made of FastQueue lanes
+//
+
+// Every producer registers and gets its own FastQueue lane, so the producers never share a cache line and each lane
+// keeps the counter free slot ownership of FastQueue. The consumer serves the lanes round robin, taking up to
+// BURST objects from a lane before moving on. With one busy lane the other lanes are only polled once every BURST
+// objects so a pop costs close to a single lane pop.
+// With a parking WaitPolicy (one with state, Park / Await) the consumer waits on its own WaitPolicy once all lanes are
+// empty. Before it does it arms a waker on every lane (LaneWait), the next push to any lane (or the stop) rings it
+// and notifies the consumer. Spin, Pause and Backoff keep no state and are not notified, the consumer polls with them.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <type_traits>
+#include "fast_queue.h"
+
+namespace FastQueueWait {
+
+//Wait policy of an MpscFastQueue lane. The producer waits on a full lane with WaitPolicy, the consumer arms a waker
+//with FastQueue::armPop() and every notify() of the lane after that calls it once.
+template<typename WaitPolicy>
+struct LaneWait {
+    template<typename Ready>
+    inline void wait(uint64_t aIteration, Ready&& aReady) noexcept {
+        mWait.wait(aIteration, std::forward<Ready>(aReady));
+    }
+    template<typename Ready>
+    inline void waitUntil(uint64_t aIteration, std::chrono::steady_clock::time_point aDeadline, Ready&& aReady) noexcept {
+        mWait.waitUntil(aIteration, aDeadline, std::forward<Ready>(aReady));
+    }
+
+    //Returns false if aReady() already is true, the waker stays armed then and is called by a later notify()
+    template<typename Ready>
+    inline bool arm(FastQueueWaker* pWaker, Ready&& aReady) noexcept {
+        //Pairs with the exchange in notify(), either the notifier takes the waker or we acquire its release and see
+        //the new state (see BasicPark::wait())
+        mpWaker.exchange(pWaker, std::memory_order_acq_rel);
+        return !aReady();
+    }
+
+    inline void notify() noexcept {
+        mWait.notify();
+        if (FastQueueWaker* lpWaker = mpWaker.exchange(nullptr, std::memory_order_acq_rel)) [[unlikely]] {
+            lpWaker->mWake(lpWaker);
+        }
+    }
+
+private:
+    WaitPolicy mWait;
+    std::atomic<FastQueueWaker*> mpWaker = nullptr;
+};
+
+}
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, uint64_t LANES, typename WaitPolicy = FastQueueWait::Spin,
+        typename ArchTraits = FastQueueArchTraits<L1_CACHE_LNE>, typename SlotCarrier = FastQueueSlot::Default<T>>
+class MpscFastQueue {
+    static_assert(LANES > 0, "At least one lane is needed");
+public:
+    //The consumer parks on WaitPolicy and the lanes notify it
+    static constexpr bool PARKING = !std::is_empty_v<WaitPolicy>;
+
+    using Lane = FastQueue<T, RING_BUFFER_SIZE, L1_CACHE_LNE, std::conditional_t<PARKING, FastQueueWait::LaneWait<WaitPolicy>, WaitPolicy>,
+            ArchTraits, SlotCarrier>;
+
+    //Objects taken from a lane before the consumer moves to the next lane
+    static constexpr uint64_t BURST = 64;
+
+    MpscFastQueue() {
+        mWaker.mWake = ring;
+        mWaker.mpWait = &mPopWait;
+    }
+
+    MpscFastQueue(const MpscFastQueue&) = delete;
+    MpscFastQueue& operator=(const MpscFastQueue&) = delete;
+
+    //Get a lane for the calling producer. Returns -1 if all lanes are taken.
+    int32_t registerProducer() {
+        uint64_t lLane = mRegistered.load(std::memory_order_relaxed);
+        do {
+            if (lLane >= LANES) {
+                return -1;
+            }
+        } while (!mRegistered.compare_exchange_weak(lLane, lLane + 1, std::memory_order_relaxed));
+        return static_cast<int32_t>(lLane);
+    }
+
+    //Producer side. Returns false if the queue is stopped.
+    template<typename... Args>
+    inline bool push(int32_t aLane, Args&&... args) noexcept {
+        return mLanes[aLane].push(std::forward<Args>(args)...);
+    }
+
+    //The lane itself, for the producer to use try_push / push_n and friends
+    inline Lane& lane(int32_t aLane) noexcept {
+        return mLanes[aLane];
+    }
+
+    //Consumer side. aOut is empty (nullptr) when the queue is stopped and all lanes are drained.
+    //Waits with WaitPolicy while all lanes are empty.
+    inline void pop(T& aOut) noexcept {
+        if (mBurst < BURST && mLanes[mLane].try_pop(aOut)) {
+            mBurst++;
+            return;
+        }
+        uint64_t lIteration = 0;
+        while (true) {
+            for (uint64_t i = 1; i <= LANES; ++i) {
+                uint64_t lLane = (mLane + i) % LANES;
+                if (mLanes[lLane].try_pop(aOut)) {
+                    mLane = lLane;
+                    mBurst = 1;
+                    return;
+                }
+            }
+            if (isStoppedAndEmpty()) [[unlikely]] {
+                aOut = SlotCarrier::decode(SlotCarrier::EMPTY);
+                return;
+            }
+            if constexpr (PARKING) {
+                //Once after a ring, so the waker is armed on every lane before the consumer parks
+                if (lIteration == 0 || mWaker.mRung.load(std::memory_order_relaxed)) {
+                    mWaker.mRung.store(false, std::memory_order_relaxed);
+                    if (!armLanes()) {
+                        continue;
+                    }
+                }
+                mPopWait.wait(lIteration++, [this] { return mWaker.mRung.load(std::memory_order_relaxed); });
+            } else {
+                ArchTraits::pause();
+            }
+        }
+    }
+
+    //Stop all lanes (Maybe called from any thread). Every lane rings an armed consumer.
+    void stopQueue() {
+        for (auto &rLane: mLanes) {
+            rLane.stopQueue();
+        }
+    }
+
+private:
+    //Armed on the lanes by the consumer, called on the thread of a producer
+    struct ConsumerWaker : FastQueueWaker {
+        std::atomic<bool> mRung = false;
+        WaitPolicy* mpWait = nullptr;
+    };
+
+    static void ring(FastQueueWaker* pWaker) {
+        auto lpWaker = static_cast<ConsumerWaker*>(pWaker);
+        lpWaker->mRung.store(true, std::memory_order_relaxed);
+        lpWaker->mpWait->notify();
+    }
+
+    //Consumer side. Returns false if a lane has an object (or is stopped) already.
+    inline bool armLanes() noexcept {
+        bool lArmed = true;
+        for (auto &rLane: mLanes) {
+            lArmed = rLane.armPop(&mWaker) && lArmed;
+        }
+        return lArmed;
+    }
+
+    inline bool isStoppedAndEmpty() const noexcept {
+        for (auto &rLane: mLanes) {
+            if (!rLane.isStoppedAndEmpty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::array<Lane, LANES> mLanes;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) uint64_t mLane = 0;
+    uint64_t mBurst = 0;
+    ConsumerWaker mWaker;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) WaitPolicy mPopWait;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) std::atomic<uint64_t> mRegistered = 0;
+    alignas(ArchTraits::DESTRUCTIVE_INTERFERENCE) volatile uint8_t mBorderDown[ArchTraits::DESTRUCTIVE_INTERFERENCE]{};
+};
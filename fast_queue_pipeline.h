@@ -0,0 +1,229 @@
+//
+// Linear pipelines of stages joined by FastQueues
+//
+
+// A pipeline is a chain of stages, each a callable from the object type of the queue before it to the object type of
+// the queue after it, the last stage (the sink) returns void. Every stage runs on its own thread (pinned to a CPU or
+// not) and the stages are joined by typed FastQueues. A stage pops a run of up to BATCH objects, runs the callable on
+// each and pushes the results as one run, so a batch pushed with push_n() stays a batch down the pipeline.
+// fuse() adds a cheap stage to the thread of the stage before it, the two callables are called back to back with no
+// queue in between. A stage returning an empty object (nullptr / 0, the value a FastQueue slot can't carry) drops it.
+// stop() closes the input, every stage drains its queue and then closes the next one, so stop and drain travel down
+// the pipeline in order.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <type_traits>
+#include "fast_queue.h"
+#include "pin_thread.h"
+
+template<typename Source, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, typename WaitPolicy = FastQueueWait::Spin,
+        typename ArchTraits = FastQueueArchTraits<L1_CACHE_LNE>>
+class FastQueuePipeline {
+    //Object type the pending stage of a Builder returns, Mid before the first stage
+    template<typename Pending, typename Mid>
+    struct PendingResult {
+        using Type = std::invoke_result_t<Pending&, Mid>;
+    };
+    template<typename Mid>
+    struct PendingResult<std::nullptr_t, Mid> {
+        using Type = Mid;
+    };
+
+public:
+    template<typename T>
+    using Queue = FastQueue<T, RING_BUFFER_SIZE, L1_CACHE_LNE, WaitPolicy, ArchTraits>;
+
+    //Objects a stage pops and pushes at a time
+    static constexpr uint64_t BATCH = std::min<uint64_t>(64, RING_BUFFER_SIZE + 1);
+
+    template<typename Mid, typename Pending>
+    class Builder;
+
+    //Start with builder().stage(...) and end with build()
+    static Builder<Source, std::nullptr_t> builder() {
+        std::unique_ptr<FastQueuePipeline> lpPipeline(new FastQueuePipeline());
+        Queue<Source>* lpInput = lpPipeline->mInput.get();
+        return Builder<Source, std::nullptr_t>(std::move(lpPipeline), lpInput, nullptr, -1);
+    }
+
+    FastQueuePipeline(const FastQueuePipeline&) = delete;
+    FastQueuePipeline& operator=(const FastQueuePipeline&) = delete;
+
+    ~FastQueuePipeline() {
+        stop();
+    }
+
+    //Producer side (one thread). Returns false after stop().
+    template<typename... Args>
+    inline bool push(Args&&... args) noexcept {
+        return mInput->push(std::forward<Args>(args)...);
+    }
+
+    //Producer side. Returns the number of objects pushed, fewer than aCount after stop().
+    template<typename Iterator>
+    inline uint64_t push_n(Iterator aItems, uint64_t aCount) noexcept {
+        return mInput->push_n(aItems, aCount);
+    }
+
+    //Close the input and wait until every stage drained its queue and returned (Maybe called from any thread, one
+    //thread at a time). A push racing the stop may return true for an object that is never delivered (see
+    //FastQueue::close()).
+    void stop() {
+        mInput->close();
+        for (auto &rStage: mStages) {
+            if (rStage->mThread.joinable()) {
+                rStage->mThread.join();
+            }
+        }
+    }
+
+    //Stage threads, fused stages share one
+    uint64_t threads() const noexcept {
+        return mStages.size();
+    }
+
+    //True if a stage could not be pinned to its CPU
+    bool pinFailed() const noexcept {
+        return mPinFailed.load(std::memory_order_relaxed);
+    }
+
+    template<typename Mid, typename Pending>
+    class Builder {
+        using Out = typename PendingResult<Pending, Mid>::Type;
+    public:
+        //Add a stage on its own thread, pinned to aCpu (-1 is not pinned)
+        template<typename Function>
+        Builder<Out, std::decay_t<Function>> stage(Function&& aFunction, int32_t aCpu = -1) && {
+            if constexpr (std::is_same_v<Pending, std::nullptr_t>) {
+                return {std::move(mpPipeline), mpTail, std::forward<Function>(aFunction), aCpu};
+            } else {
+                using Next = Out;
+                static_assert(!std::is_void_v<Next>, "Only the last stage (the sink) may return void");
+                auto lpStage = std::make_unique<Stage<Mid, Next, Pending>>(mpTail, std::move(mPending), mCpu);
+                Queue<Next>* lpTail = lpStage->mOut.get();
+                mpPipeline->mStages.push_back(std::move(lpStage));
+                return {std::move(mpPipeline), lpTail, std::forward<Function>(aFunction), aCpu};
+            }
+        }
+
+        //Add a stage on the thread of the stage before it
+        template<typename Function>
+        auto fuse(Function&& aFunction) && {
+            static_assert(!std::is_same_v<Pending, std::nullptr_t>, "fuse() needs a stage before it");
+            using First = std::invoke_result_t<Pending&, Mid>;
+            static_assert(!std::is_void_v<First>, "Only the last stage (the sink) may return void");
+            using Second = std::invoke_result_t<std::decay_t<Function>&, First>;
+            auto lFused = [lFirst = std::move(mPending), lSecond = std::forward<Function>(aFunction)](Mid aObj) mutable -> Second {
+                First lObj = lFirst(std::move(aObj));
+                if (isEmpty(lObj)) {
+                    if constexpr (std::is_void_v<Second>) {
+                        return;
+                    } else {
+                        return Second{};
+                    }
+                }
+                return lSecond(std::move(lObj));
+            };
+            return Builder<Mid, decltype(lFused)>(std::move(mpPipeline), mpTail, std::move(lFused), mCpu);
+        }
+
+        //Start the stage threads. The last stage has to be a sink (return void).
+        std::unique_ptr<FastQueuePipeline> build() && {
+            static_assert(!std::is_same_v<Pending, std::nullptr_t>, "A pipeline needs at least one stage");
+            static_assert(std::is_void_v<Out>, "The last stage has to be a sink (return void)");
+            mpPipeline->mStages.push_back(std::make_unique<Stage<Mid, void, Pending>>(mpTail, std::move(mPending), mCpu));
+            FastQueuePipeline* lpPipeline = mpPipeline.get();
+            for (auto &rStage: mpPipeline->mStages) {
+                StageBase* lpStage = rStage.get();
+                lpStage->mThread = std::thread([lpPipeline, lpStage] {
+                    if (lpStage->mCpu >= 0 && !pinThread(lpStage->mCpu)) {
+                        lpPipeline->mPinFailed = true;
+                    }
+                    lpStage->run();
+                });
+            }
+            return std::move(mpPipeline);
+        }
+
+        Builder(std::unique_ptr<FastQueuePipeline> pPipeline, Queue<Mid>* pTail, Pending aPending, int32_t aCpu) :
+                mpPipeline(std::move(pPipeline)), mpTail(pTail), mPending(std::move(aPending)), mCpu(aCpu) {}
+
+    private:
+        std::unique_ptr<FastQueuePipeline> mpPipeline;
+        //The queue the pending stage pops
+        Queue<Mid>* mpTail;
+        //The last stage added, it becomes a Stage when the next one is added (or fused into it)
+        Pending mPending;
+        int32_t mCpu;
+    };
+
+private:
+    FastQueuePipeline() : mInput(std::make_unique<Queue<Source>>()) {}
+
+    template<typename T>
+    static bool isEmpty(const T& rObj) noexcept {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            return FastQueueSlot::toWord(rObj) == 0;
+        } else {
+            return !rObj;
+        }
+    }
+
+    struct StageBase {
+        virtual ~StageBase() = default;
+        virtual void run() = 0;
+        int32_t mCpu = -1;
+        std::thread mThread;
+    };
+
+    //Pops In from mpIn, pushes the results to mOut (owned here) and closes it once mpIn is stopped and empty
+    template<typename In, typename Result, typename Function>
+    struct Stage : StageBase {
+        Stage(Queue<In>* pIn, Function aFunction, int32_t aCpu) : mpIn(pIn), mFunction(std::move(aFunction)) {
+            this->mCpu = aCpu;
+            if constexpr (!std::is_void_v<Result>) {
+                mOut = std::make_unique<Queue<Result>>();
+            }
+        }
+
+        void run() override {
+            std::array<In, BATCH> lIn{};
+            if constexpr (std::is_void_v<Result>) {
+                while (uint64_t lCount = mpIn->pop_n(lIn.begin(), BATCH)) {
+                    for (uint64_t i = 0; i < lCount; ++i) {
+                        mFunction(std::move(lIn[i]));
+                    }
+                }
+            } else {
+                std::array<Result, BATCH> lOut{};
+                while (uint64_t lCount = mpIn->pop_n(lIn.begin(), BATCH)) {
+                    uint64_t lKept = 0;
+                    for (uint64_t i = 0; i < lCount; ++i) {
+                        Result lObj = mFunction(std::move(lIn[i]));
+                        if (!isEmpty(lObj)) {
+                            lOut[lKept++] = std::move(lObj);
+                        }
+                    }
+                    mOut->push_n(lOut.begin(), lKept);
+                }
+                mOut->close();
+            }
+        }
+
+        Queue<In>* mpIn;
+        Function mFunction;
+        std::unique_ptr<Queue<std::conditional_t<std::is_void_v<Result>, In, Result>>> mOut;
+    };
+
+    //In order, mStages[i + 1] pops the queue mStages[i] owns
+    std::unique_ptr<Queue<Source>> mInput;
+    std::vector<std::unique_ptr<StageBase>> mStages;
+    std::atomic<bool> mPinFailed = false;
+};
@@ -0,0 +1,64 @@
+//
+// FastQueue with a return channel and a preallocated object arena
+//
+
+// new in the producer and delete in the consumer makes the allocator's cross thread free path the bottleneck.
+// FastQueuePool preallocates the objects and couples the forward FastQueue with a reverse FastQueue the consumer uses
+// to hand spent objects back to the producer, so steady state operation does no heap allocations.
+// The arena holds exactly as many objects as the reverse queue has slots, so recycle() never waits on a full queue.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "fast_queue.h"
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, typename WaitPolicy = FastQueueWait::Spin>
+class FastQueuePool {
+public:
+    static constexpr uint64_t ARENA_SIZE = RING_BUFFER_SIZE + 1;
+
+    FastQueuePool() : mArena(std::make_unique<T[]>(ARENA_SIZE)) {}
+
+    //Producer side. Get a free object, waits for the consumer to recycle one if all are in flight.
+    //Returns nullptr if the queue is stopped.
+    inline T* acquire() noexcept {
+        T* lpObj = nullptr;
+        if (mReturnQueue.try_pop(lpObj)) {
+            return lpObj;
+        }
+        if (mArenaNext < ARENA_SIZE) {
+            return &mArena[mArenaNext++];
+        }
+        mReturnQueue.pop(lpObj);
+        return lpObj;
+    }
+
+    //Producer side. Pass an object acquired from the pool to the consumer.
+    //Returns false (and the object is not pushed) if the queue is stopped
+    inline bool push(T* pObj) noexcept {
+        return mQueue.push(pObj);
+    }
+
+    //Consumer side. rOut is nullptr if the queue is stopped.
+    inline void pop(T*& rOut) noexcept {
+        mQueue.pop(rOut);
+    }
+
+    //Consumer side. Hand a spent object back to the producer.
+    inline void recycle(T* pObj) noexcept {
+        mReturnQueue.push(pObj);
+    }
+
+    //Stop both directions (Maybe called from any thread)
+    void stopQueue() {
+        mQueue.stopQueue();
+        mReturnQueue.stopQueue();
+    }
+
+private:
+    FastQueue<T*, RING_BUFFER_SIZE, L1_CACHE_LNE, WaitPolicy> mQueue;
+    FastQueue<T*, RING_BUFFER_SIZE, L1_CACHE_LNE, WaitPolicy> mReturnQueue;
+    std::unique_ptr<T[]> mArena;
+    uint64_t mArenaNext = 0;
+};
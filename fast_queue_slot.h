@@ -0,0 +1,117 @@
+//
+// Slot carriers for FastQueue
+//
+
+// A slot carrier decides how an 8 byte object is stored in a 64-bit slot word and what marks a slot as empty.
+// encode() / isFull() get the queue position of the slot so a carrier can tag the word with a sequence.
+// An OWNING carrier owns the object while it is in the queue, the queue deletes objects left in it (decode() and
+// let the result go) when it is reset or destroyed. Plain is the default and is the original nullptr / 0 means empty
+// behavior, Owned is the default for move only smart pointers.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace FastQueueSlot {
+
+template<typename T>
+inline uint64_t toWord(const T& aObj) noexcept {
+    static_assert(sizeof(T) == 8 && std::is_trivially_copyable_v<T>, "The object must be a trivially copyable 8 byte type");
+    uint64_t lWord;
+    std::memcpy(&lWord, &aObj, sizeof(uint64_t));
+    return lWord;
+}
+
+template<typename T>
+inline T fromWord(uint64_t aWord) noexcept {
+    T lObj;
+    std::memcpy(&lObj, &aWord, sizeof(uint64_t));
+    return lObj;
+}
+
+//All zero bits (nullptr / 0) marks an empty slot, so 0 can't be pushed
+template<typename T>
+struct Plain {
+    static constexpr bool OWNING = false;
+    static constexpr uint64_t EMPTY = 0;
+
+    static inline bool isFull(uint64_t aWord, uint64_t) noexcept {
+        return aWord != EMPTY;
+    }
+    static inline uint64_t encode(const T& aObj, uint64_t) noexcept {
+        return toWord(aObj);
+    }
+    static inline T decode(uint64_t aWord) noexcept {
+        return fromWord<T>(aWord);
+    }
+};
+
+//EMPTY_VALUE marks an empty slot and is the only value that can't be pushed. pop() returns it when the queue is stopped.
+template<typename T, uint64_t EMPTY_VALUE>
+struct Sentinel {
+    static constexpr bool OWNING = false;
+    static constexpr uint64_t EMPTY = EMPTY_VALUE;
+
+    static inline bool isFull(uint64_t aWord, uint64_t) noexcept {
+        return aWord != EMPTY;
+    }
+    static inline uint64_t encode(const T& aObj, uint64_t) noexcept {
+        return toWord(aObj);
+    }
+    static inline T decode(uint64_t aWord) noexcept {
+        return fromWord<T>(aWord);
+    }
+};
+
+//The high TAG_BITS of the word carry a full flag and the low bits of the position, the payload is the low
+//64 - TAG_BITS bits of the object. Any payload (0 as well) can be pushed and the consumer only accepts a slot written
+//for its own position. pop() can't signal stop with a value, use pop_for() / try_pop().
+template<typename T, uint64_t TAG_BITS = 16>
+struct Tagged {
+    static_assert(TAG_BITS >= 1 && TAG_BITS < 64, "TAG_BITS must be 1..63");
+    static constexpr uint64_t PAYLOAD_BITS = 64 - TAG_BITS;
+    static constexpr uint64_t PAYLOAD_MASK = (1ULL << PAYLOAD_BITS) - 1;
+    static constexpr uint64_t SEQUENCE_MASK = (1ULL << (TAG_BITS - 1)) - 1;
+    static constexpr bool OWNING = false;
+    static constexpr uint64_t EMPTY = 0;
+
+    static inline uint64_t tag(uint64_t aPosition) noexcept {
+        return (1ULL << (TAG_BITS - 1)) | (aPosition & SEQUENCE_MASK);
+    }
+    static inline bool isFull(uint64_t aWord, uint64_t aPosition) noexcept {
+        return (aWord >> PAYLOAD_BITS) == tag(aPosition);
+    }
+    static inline uint64_t encode(const T& aObj, uint64_t aPosition) noexcept {
+        return (tag(aPosition) << PAYLOAD_BITS) | (toWord(aObj) & PAYLOAD_MASK);
+    }
+    static inline T decode(uint64_t aWord) noexcept {
+        return fromWord<T>(aWord & PAYLOAD_MASK);
+    }
+};
+
+//std::unique_ptr with a stateless deleter, or any 8 byte handle with pointer / release() / construction from a
+//pointer. push() moves the object in and releases it into the slot, pop() moves it out. nullptr is empty.
+template<typename T>
+struct Owned {
+    static_assert(sizeof(T) == 8 && sizeof(typename T::pointer) == 8, "The owner must be a single pointer");
+    static constexpr bool OWNING = true;
+    static constexpr uint64_t EMPTY = 0;
+
+    static inline bool isFull(uint64_t aWord, uint64_t) noexcept {
+        return aWord != EMPTY;
+    }
+    static inline uint64_t encode(T&& aObj, uint64_t) noexcept {
+        return reinterpret_cast<uint64_t>(aObj.release());
+    }
+    static inline T decode(uint64_t aWord) noexcept {
+        return T(reinterpret_cast<typename T::pointer>(aWord));
+    }
+};
+
+//Plain for trivially copyable objects, Owned for the rest
+template<typename T>
+using Default = std::conditional_t<std::is_trivially_copyable_v<T>, Plain<T>, Owned<T>>;
+
+}
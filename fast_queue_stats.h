@@ -0,0 +1,119 @@
+//
+// Instrumentation policies for FastQueue
+//
+
+// The last template parameter of FastQueue. None is the default, its hooks are empty and the queue compiles to the
+// uninstrumented code. Counters keeps the producer counters next to the write position and the consumer counters
+// next to the read position, each counter has a single writer so it is a relaxed load and store (no locked RMW).
+// FastQueue::stats() reads them with relaxed loads and may be called from any thread, for example a monitoring thread.
+// The consumer samples the depth (objects in the queue) once for every pop call by reading the write position,
+// that is one more read of the producer cache line per pop and the cost of turning the counters on.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <array>
+
+namespace FastQueueStats {
+
+//log2 buckets, bucket i counts the pop calls that found 2^i to 2^(i+1) - 1 objects in the queue
+static constexpr uint64_t DEPTH_BUCKETS = 64;
+
+struct Snapshot {
+    uint64_t mPushes = 0;
+    uint64_t mPops = 0;
+    //Failed slot checks of the producer on a full queue / the consumer on an empty queue
+    uint64_t mFullSpins = 0;
+    uint64_t mEmptySpins = 0;
+    uint64_t mMaxDepth = 0;
+    std::array<uint64_t, DEPTH_BUCKETS> mDepthHistogram{};
+};
+
+//Written by one thread, read by any
+struct Counter {
+    inline void add(uint64_t aValue) noexcept {
+        mValue.store(mValue.load(std::memory_order_relaxed) + aValue, std::memory_order_relaxed);
+    }
+    inline void max(uint64_t aValue) noexcept {
+        if (aValue > mValue.load(std::memory_order_relaxed)) {
+            mValue.store(aValue, std::memory_order_relaxed);
+        }
+    }
+    inline uint64_t load() const noexcept {
+        return mValue.load(std::memory_order_relaxed);
+    }
+private:
+    std::atomic<uint64_t> mValue = 0;
+};
+
+//No instrumentation
+struct None {
+    static constexpr bool ENABLED = false;
+
+    struct Producer {
+        inline void onPush(uint64_t, uint64_t) noexcept {}
+    };
+    struct Consumer {
+        inline void onPop(uint64_t, uint64_t, uint64_t) noexcept {}
+    };
+
+    static inline Snapshot snapshot(const Producer&, const Consumer&) noexcept {
+        return {};
+    }
+};
+
+struct Counters {
+    static constexpr bool ENABLED = true;
+
+    struct Producer {
+        //aCount objects pushed (0 for a failed try) after aSpins failed slot checks
+        inline void onPush(uint64_t aCount, uint64_t aSpins) noexcept {
+            if (aCount) mPushes.add(aCount);
+            if (aSpins) [[unlikely]] mFullSpins.add(aSpins);
+        }
+        Counter mPushes;
+        Counter mFullSpins;
+    };
+
+    struct Consumer {
+        //aCount objects popped (0 for a failed try) after aSpins failed slot checks, aDepth objects were in the queue
+        inline void onPop(uint64_t aCount, uint64_t aSpins, uint64_t aDepth) noexcept {
+            if (aSpins) mEmptySpins.add(aSpins);
+            if (!aCount) return;
+            mPops.add(aCount);
+            mMaxDepth.max(aDepth);
+            mDepthHistogram[depthBucket(aDepth)].add(1);
+        }
+        Counter mPops;
+        Counter mEmptySpins;
+        Counter mMaxDepth;
+        std::array<Counter, DEPTH_BUCKETS> mDepthHistogram;
+    };
+
+    static inline Snapshot snapshot(const Producer& rProducer, const Consumer& rConsumer) noexcept {
+        Snapshot lSnapshot;
+        lSnapshot.mPushes = rProducer.mPushes.load();
+        lSnapshot.mFullSpins = rProducer.mFullSpins.load();
+        lSnapshot.mPops = rConsumer.mPops.load();
+        lSnapshot.mEmptySpins = rConsumer.mEmptySpins.load();
+        lSnapshot.mMaxDepth = rConsumer.mMaxDepth.load();
+        for (uint64_t i = 0; i < DEPTH_BUCKETS; ++i) {
+            lSnapshot.mDepthHistogram[i] = rConsumer.mDepthHistogram[i].load();
+        }
+        return lSnapshot;
+    }
+
+    //Index of the highest bit set (aDepth > 0)
+    static inline uint64_t depthBucket(uint64_t aDepth) noexcept {
+#ifdef _MSC_VER
+        unsigned long lIndex;
+        _BitScanReverse64(&lIndex, aDepth);
+        return lIndex;
+#else
+        return 63 - __builtin_clzll(aDepth);
+#endif
+    }
+};
+
+}
@@ -0,0 +1,266 @@
+//
+// Wait policies for FastQueue
+//
+
+// A wait policy decides what a FastQueue side does while it is waiting on a full (push) or empty (pop) queue.
+// wait() is called once for every failed slot check with the number of failed checks so far, notify() is called by
+// the other side every time it frees or fills a slot. waitUntil() is the same for the timed push_until() / pop_until()
+// and must return by the deadline. Spin is the default and compiles to the plain busy loop.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "fast_queue_arch.h"
+
+#if defined _WIN64
+#include <Windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined __APPLE__
+extern "C" int __ulock_wait(uint32_t aOperation, void *pAddr, uint64_t aValue, uint32_t aTimeout);
+extern "C" int __ulock_wake(uint32_t aOperation, void *pAddr, uint64_t aWakeValue);
+#define FAST_QUEUE_UL_COMPARE_AND_WAIT 1
+#define FAST_QUEUE_UL_COMPARE_AND_WAIT_SHARED 3
+#define FAST_QUEUE_ULF_NO_ERRNO 0x01000000
+#elif defined __linux
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#else
+#error OS not supported
+#endif
+
+//A process shared wait never sleeps longer than this, so the waiter gets to check if the other process is alive
+static constexpr uint32_t FAST_QUEUE_SHARED_WAIT_US = 1000;
+
+//Sleep while *pAddr == aExpected (or until woken) for at most aTimeoutUs (> 0) microseconds.
+//aShared for a pAddr in memory shared between processes.
+inline void fastQueueFutexWaitFor(std::atomic<uint32_t> *pAddr, uint32_t aExpected, uint32_t aTimeoutUs, bool aShared = false) noexcept {
+#if defined _WIN64
+    WaitOnAddress(pAddr, &aExpected, sizeof(uint32_t), (aTimeoutUs + 999) / 1000);
+#elif defined __APPLE__
+    __ulock_wait((aShared ? FAST_QUEUE_UL_COMPARE_AND_WAIT_SHARED : FAST_QUEUE_UL_COMPARE_AND_WAIT) | FAST_QUEUE_ULF_NO_ERRNO,
+                 pAddr, aExpected, aTimeoutUs);
+#else
+    timespec lTimeout = {static_cast<time_t>(aTimeoutUs / 1000000), static_cast<long>(aTimeoutUs % 1000000) * 1000L};
+    syscall(SYS_futex, pAddr, aShared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, aExpected, &lTimeout, nullptr, 0);
+#endif
+}
+
+//Sleep while *pAddr == aExpected (or until woken). aShared for a pAddr in memory shared between processes.
+inline void fastQueueFutexWait(std::atomic<uint32_t> *pAddr, uint32_t aExpected, bool aShared = false) noexcept {
+    if (aShared) {
+        fastQueueFutexWaitFor(pAddr, aExpected, FAST_QUEUE_SHARED_WAIT_US, true);
+        return;
+    }
+#if defined _WIN64
+    WaitOnAddress(pAddr, &aExpected, sizeof(uint32_t), INFINITE);
+#elif defined __APPLE__
+    __ulock_wait(FAST_QUEUE_UL_COMPARE_AND_WAIT | FAST_QUEUE_ULF_NO_ERRNO, pAddr, aExpected, 0);
+#else
+    syscall(SYS_futex, pAddr, FUTEX_WAIT_PRIVATE, aExpected, nullptr, nullptr, 0);
+#endif
+}
+
+//A one shot callback armed on a FastQueueWait::Await side (armPush() / armPop()), mWake(this) is called on the thread
+//of the other side. Derive from it to carry the context, fast_queue_coro.h resumes a coroutine from it.
+struct FastQueueWaker {
+    void (*mWake)(FastQueueWaker*) = nullptr;
+};
+
+//Result of the timed push_until() / pop_until()
+enum class FastQueueStatus {
+    Ok,
+    Timeout,
+    Stopped
+};
+
+//Wake the thread sleeping on pAddr
+inline void fastQueueFutexWake(std::atomic<uint32_t> *pAddr, bool aShared = false) noexcept {
+#if defined _WIN64
+    WakeByAddressSingle(pAddr);
+#elif defined __APPLE__
+    __ulock_wake((aShared ? FAST_QUEUE_UL_COMPARE_AND_WAIT_SHARED : FAST_QUEUE_UL_COMPARE_AND_WAIT) | FAST_QUEUE_ULF_NO_ERRNO, pAddr, 0);
+#else
+    syscall(SYS_futex, pAddr, aShared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+namespace FastQueueWait {
+
+//PROCESS_SHARED is true for a policy that can wait for a side in another process (FastQueueIpc)
+
+//Busy loop (the original FastQueue behavior)
+struct Spin {
+    static constexpr bool PROCESS_SHARED = true;
+
+    template<typename Ready>
+    inline void wait(uint64_t, Ready&&) noexcept {}
+    template<typename Ready>
+    inline void waitUntil(uint64_t, std::chrono::steady_clock::time_point, Ready&&) noexcept {}
+    inline void notify() noexcept {}
+};
+
+//Busy loop with a PAUSE/YIELD hint so the SMT sibling gets the core
+struct Pause {
+    static constexpr bool PROCESS_SHARED = true;
+
+    template<typename Ready>
+    inline void wait(uint64_t, Ready&&) noexcept {
+        FastQueueArchTraits<>::pause();
+    }
+    template<typename Ready>
+    inline void waitUntil(uint64_t, std::chrono::steady_clock::time_point, Ready&&) noexcept {
+        FastQueueArchTraits<>::pause();
+    }
+    inline void notify() noexcept {}
+};
+
+//Exponentially growing PAUSE/YIELD runs, then give the time slice back to the OS
+struct Backoff {
+    static constexpr bool PROCESS_SHARED = true;
+    static constexpr uint64_t PAUSE_ROUNDS = 10;
+
+    template<typename Ready>
+    inline void wait(uint64_t aIteration, Ready&&) noexcept {
+        if (aIteration < PAUSE_ROUNDS) {
+            for (uint64_t i = 0; i < (1ULL << aIteration); ++i) {
+                FastQueueArchTraits<>::pause();
+            }
+            return;
+        }
+        std::this_thread::yield();
+    }
+    template<typename Ready>
+    inline void waitUntil(uint64_t aIteration, std::chrono::steady_clock::time_point, Ready&& aReady) noexcept {
+        wait(aIteration, std::forward<Ready>(aReady));
+    }
+    inline void notify() noexcept {}
+};
+
+//Spin for a while then sleep on a futex. The other side only pays for the wake syscall when a thread is parked.
+//PROCESS_SHARED for a queue in shared memory (FastQueueIpc), the sleep is then bounded by FAST_QUEUE_SHARED_WAIT_US.
+template<bool SHARED>
+struct BasicPark {
+    static constexpr bool PROCESS_SHARED = SHARED;
+    static constexpr uint64_t SPIN_ROUNDS = 1024;
+    //waitUntil() spins this long before it parks, the PAUSE / YIELD rounds for it are measured once
+    static constexpr std::chrono::nanoseconds SPIN_WINDOW = std::chrono::microseconds(10);
+
+    template<typename Ready>
+    inline void wait(uint64_t aIteration, Ready&& aReady) noexcept {
+        if (aIteration < SPIN_ROUNDS) {
+            FastQueueArchTraits<>::pause();
+            return;
+        }
+        uint32_t lSequence = mSequence.load(std::memory_order_acquire);
+        //Pairs with the RMW in notify(). Both are RMWs on mWaiter, so either the notifier reads our flag or we read
+        //(and acquire) the notifier's and see the new state.
+        mWaiter.exchange(1, std::memory_order_acq_rel);
+        if (!aReady()) {
+            fastQueueFutexWait(&mSequence, lSequence, PROCESS_SHARED);
+        }
+        mWaiter.store(0, std::memory_order_relaxed);
+    }
+
+    template<typename Ready>
+    inline void waitUntil(uint64_t aIteration, std::chrono::steady_clock::time_point aDeadline, Ready&& aReady) noexcept {
+        if (aIteration < spinWindowRounds()) {
+            FastQueueArchTraits<>::pause();
+            return;
+        }
+        auto lRemaining = std::chrono::duration_cast<std::chrono::microseconds>(aDeadline - std::chrono::steady_clock::now()).count();
+        if (lRemaining <= 0) {
+            return;
+        }
+        uint32_t lTimeoutUs = static_cast<uint32_t>(std::min<int64_t>(lRemaining, PROCESS_SHARED ? FAST_QUEUE_SHARED_WAIT_US : UINT32_MAX));
+        uint32_t lSequence = mSequence.load(std::memory_order_acquire);
+        //See wait()
+        mWaiter.exchange(1, std::memory_order_acq_rel);
+        if (!aReady()) {
+            fastQueueFutexWaitFor(&mSequence, lSequence, lTimeoutUs, PROCESS_SHARED);
+        }
+        mWaiter.store(0, std::memory_order_relaxed);
+    }
+
+    static uint64_t spinWindowRounds() noexcept {
+        static const uint64_t lRounds = [] {
+            constexpr uint64_t CALIBRATION_ROUNDS = 1000;
+            auto lStart = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < CALIBRATION_ROUNDS; ++i) {
+                FastQueueArchTraits<>::pause();
+            }
+            auto lElapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - lStart);
+            return std::max<uint64_t>(1, CALIBRATION_ROUNDS * SPIN_WINDOW.count() / std::max<int64_t>(1, lElapsed.count()));
+        }();
+        return lRounds;
+    }
+
+    inline void notify() noexcept {
+        //An RMW (not a load) reads the latest flag, and its release hands the new state to a waiter reading it
+        if (mWaiter.fetch_or(0, std::memory_order_acq_rel)) [[unlikely]] {
+            mSequence.fetch_add(1, std::memory_order_release);
+            fastQueueFutexWake(&mSequence, PROCESS_SHARED);
+        }
+    }
+
+private:
+    std::atomic<uint32_t> mSequence = 0;
+    std::atomic<uint32_t> mWaiter = 0;
+};
+
+using Park = BasicPark<false>;
+using ParkShared = BasicPark<true>;
+
+//Park for a thread waiting in the blocking calls, and a one shot FastQueueWaker for a side that can't block (a
+//coroutine, an event loop) armed with arm(). The arm state is a counter, odd while a waker is armed. notify() moves it
+//on before calling the waker so it is called once, and an arm() taking its waker back only succeeds for its own count
+//(the woken side may already have armed again with the same waker address). A notify() for an object the armed side
+//already got calls the waker as well, the waker has to check the side is ready (arm() again returns false).
+struct Await {
+    static constexpr bool PROCESS_SHARED = false;
+
+    template<typename Ready>
+    inline void wait(uint64_t aIteration, Ready&& aReady) noexcept {
+        mPark.wait(aIteration, std::forward<Ready>(aReady));
+    }
+    template<typename Ready>
+    inline void waitUntil(uint64_t aIteration, std::chrono::steady_clock::time_point aDeadline, Ready&& aReady) noexcept {
+        mPark.waitUntil(aIteration, aDeadline, std::forward<Ready>(aReady));
+    }
+
+    //Returns false (and pWaker is not armed) if aReady() already is true. Otherwise pWaker is called once, maybe
+    //before arm() returns.
+    template<typename Ready>
+    inline bool arm(FastQueueWaker* pWaker, Ready&& aReady) noexcept {
+        uint64_t lArmed = mState.load(std::memory_order_relaxed) + 1;
+        mpWaker = pWaker;
+        //Pairs with the RMW in notify(), either the notifier reads the armed state or we acquire its release and see
+        //the new state (see BasicPark::wait())
+        mState.exchange(lArmed, std::memory_order_acq_rel);
+        return !(aReady() && mState.compare_exchange_strong(lArmed, lArmed + 1, std::memory_order_relaxed));
+    }
+
+    inline void notify() noexcept {
+        mPark.notify();
+        uint64_t lState = mState.fetch_or(0, std::memory_order_acq_rel);
+        if (lState & 1) [[unlikely]] {
+            if (mState.compare_exchange_strong(lState, lState + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                FastQueueWaker* lpWaker = mpWaker;
+                lpWaker->mWake(lpWaker);
+            }
+        }
+    }
+
+private:
+    Park mPark;
+    std::atomic<uint64_t> mState = 0;
+    //Written by arm() before the release exchange of mState, read by the notifier moving mState on
+    FastQueueWaker* mpWaker = nullptr;
+};
+
+}
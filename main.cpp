@@ -1,14 +1,12 @@
 #include <iostream>
 #include <thread>
 #include <new>
+#include <array>
+#include <memory>
 
-#if __x86_64__ || _M_X64
-#include "fast_queue_x86_64.h"
-#elif __aarch64__ || _M_ARM64
-#include "fast_queue_arm64.h"
-#else
-#error Architecture not supported
-#endif
+#include "fast_queue.h"
+#include "fast_queue_inline.h"
+#include "fast_queue_pool.h"
 
 #include "deaod_spsc/spsc_queue.hpp"
 #include "pin_thread.h"
@@ -20,6 +18,8 @@
 #define CONSUMER_CPU 1
 //Run the producer on CPU
 #define PRODUCER_CPU 3
+//Number of objects moved per batch in the batch tests
+#define BATCH_SIZE 32
 
 std::atomic<uint64_t> gActiveConsumer = 0;
 std::atomic<uint64_t> gCounter = 0;
@@ -31,6 +31,12 @@ public:
     uint64_t mIndex;
 };
 
+//A 48 byte market data like object passed by value in the inline test
+struct MyPayload {
+    uint64_t mIndex;
+    uint64_t mData[5];
+};
+
 /// -----------------------------------------------------------
 ///
 /// deaodSPSC section Start
@@ -88,6 +94,62 @@ void deaodSPSCConsumer(deaod::spsc_queue<MyObject*, QUEUE_MASK, 6> *pQueue, int3
     gActiveConsumer--;
 }
 
+void deaodSPSCBatchProducer(deaod::spsc_queue<MyObject*, QUEUE_MASK, 6> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    std::array<MyObject*, BATCH_SIZE> lObjects{};
+    while (gActiveProducer) {
+        for (auto &rObject: lObjects) {
+            rObject = new MyObject();
+            rObject->mIndex = lCounter++;
+        }
+        auto lFirst = lObjects.begin();
+        while (lFirst != lObjects.end() && gActiveProducer) {
+            lFirst += pQueue->write(lFirst, lObjects.end());
+        }
+    }
+}
+
+void deaodSPSCBatchConsumer(deaod::spsc_queue<MyObject*, QUEUE_MASK, 6> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    std::array<MyObject*, BATCH_SIZE> lResults{};
+    while (gActiveProducer) {
+        //Not read(), its trivially copyable path copies into the ring instead of out of it
+        uint64_t lPopped = 0;
+        pQueue->consume_all([&](MyObject** pObject) {
+            if (lPopped == lResults.size()) {
+                return false;
+            }
+            lResults[lPopped++] = *pObject;
+            return true;
+        });
+        for (uint64_t i = 0; i < lPopped; ++i) {
+            if (lResults[i]->mIndex != lCounter) {
+                std::cout << "Queue item error" << std::endl;
+            }
+            lCounter++;
+            delete lResults[i];
+        }
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
 /// -----------------------------------------------------------
 ///
 /// deaodSPSC section End
@@ -101,7 +163,12 @@ void deaodSPSCConsumer(deaod::spsc_queue<MyObject*, QUEUE_MASK, 6> *pQueue, int3
 ///
 /// -----------------------------------------------------------
 
-void fastQueueProducer(FastQueue<MyObject*, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+//The pointer test runs with the default traits and with the consumer emptying the slots in deferred batches
+using FastQueueDeferred = FastQueue<MyObject*, QUEUE_MASK, L1_CACHE_LINE, FastQueueWait::Spin,
+        FastQueueDeferredClearTraits<L1_CACHE_LINE>>;
+
+template<typename Queue>
+void fastQueueProducer(Queue *pQueue, int32_t aCPU) {
     if (!pinThread(aCPU)) {
         std::cout << "Pin CPU fail. " << std::endl;
         return;
@@ -122,7 +189,8 @@ void fastQueueProducer(FastQueue<MyObject*, QUEUE_MASK, L1_CACHE_LINE> *pQueue,
     pQueue->stopQueue();
 }
 
-void fastQueueConsumer(FastQueue<MyObject*, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+template<typename Queue>
+void fastQueueConsumer(Queue *pQueue, int32_t aCPU) {
     if (!pinThread(aCPU)) {
         std::cout << "Pin CPU fail. " << std::endl;
         gActiveConsumer--;
@@ -145,6 +213,232 @@ void fastQueueConsumer(FastQueue<MyObject*, QUEUE_MASK, L1_CACHE_LINE> *pQueue,
     gActiveConsumer--;
 }
 
+void fastQueueBatchProducer(FastQueue<MyObject*, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    std::array<MyObject*, BATCH_SIZE> lObjects{};
+    while (gActiveProducer) {
+        for (auto &rObject: lObjects) {
+            rObject = new MyObject();
+            rObject->mIndex = lCounter++;
+        }
+        pQueue->push_n(lObjects.begin(), BATCH_SIZE);
+    }
+    pQueue->stopQueue();
+}
+
+void fastQueueBatchConsumer(FastQueue<MyObject*, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    std::array<MyObject*, BATCH_SIZE> lResults{};
+    while (true) {
+        uint64_t lPopped = pQueue->pop_n(lResults.begin(), BATCH_SIZE);
+        if (!lPopped) {
+            break;
+        }
+        for (uint64_t i = 0; i < lPopped; ++i) {
+            if (lResults[i]->mIndex != lCounter) {
+                std::cout << "Queue item error. got: " << lResults[i]->mIndex << " expected: " << lCounter << std::endl;
+            }
+            lCounter++;
+            delete lResults[i];
+        }
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+//Same as the pointer test but ownership is passed with std::unique_ptr (FastQueueSlot::Owned is picked by default)
+void fastQueueUniqueProducer(FastQueue<std::unique_ptr<MyObject>, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        auto lTheObject = std::make_unique<MyObject>();
+        lTheObject->mIndex = lCounter++;
+        pQueue->push(std::move(lTheObject));
+    }
+    pQueue->stopQueue();
+}
+
+void fastQueueUniqueConsumer(FastQueue<std::unique_ptr<MyObject>, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        std::unique_ptr<MyObject> lResult;
+        pQueue->pop(lResult);
+        if (!lResult) {
+            break;
+        }
+        if (lResult->mIndex != lCounter) {
+            std::cout << "Queue item error. got: " << lResult->mIndex << " expected: " << lCounter << std::endl;
+        }
+        lCounter++;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+//64-bit values instead of pointers, no allocation per object. ~0 is the empty marker so 0 can be pushed.
+using FastQueueValue = FastQueue<uint64_t, QUEUE_MASK, L1_CACHE_LINE, FastQueueWait::Spin,
+        FastQueueArchTraits<L1_CACHE_LINE>, FastQueueSlot::Sentinel<uint64_t, UINT64_MAX>>;
+
+void fastQueueValueProducer(FastQueueValue *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        pQueue->push(lCounter++);
+    }
+    pQueue->stopQueue();
+}
+
+void fastQueueValueConsumer(FastQueueValue *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        uint64_t lResult = 0;
+        pQueue->pop(lResult);
+        if (lResult == UINT64_MAX) {
+            break;
+        }
+        if (lResult != lCounter) {
+            std::cout << "Queue item error. got: " << lResult << " expected: " << lCounter << std::endl;
+        }
+        lCounter++;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+void fastQueueInlineProducer(FastQueueInline<MyPayload, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    MyPayload lPayload{};
+    while (gActiveProducer) {
+        lPayload.mIndex = lCounter++;
+        pQueue->push(lPayload);
+    }
+    pQueue->stopQueue();
+}
+
+void fastQueueInlineConsumer(FastQueueInline<MyPayload, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    MyPayload lResult{};
+    while (pQueue->pop(lResult)) {
+        if (lResult.mIndex != lCounter) {
+            std::cout << "Queue item error. got: " << lResult.mIndex << " expected: " << lCounter << std::endl;
+        }
+        lCounter++;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+void fastQueuePoolProducer(FastQueuePool<MyObject, QUEUE_MASK, L1_CACHE_LINE> *pPool, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        auto lTheObject = pPool->acquire();
+        if (!lTheObject) {
+            break;
+        }
+        lTheObject->mIndex = lCounter++;
+        if (!pPool->push(lTheObject)) {
+            break;
+        }
+    }
+    pPool->stopQueue();
+}
+
+void fastQueuePoolConsumer(FastQueuePool<MyObject, QUEUE_MASK, L1_CACHE_LINE> *pPool, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        MyObject* pResult = nullptr;
+        pPool->pop(pResult);
+        if (pResult == nullptr) {
+            break;
+        }
+        if (pResult->mIndex != lCounter) {
+            std::cout << "Queue item error. got: " << pResult->mIndex << " expected: " << lCounter << std::endl;
+        }
+        lCounter++;
+        pPool->recycle(pResult);
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
 /// -----------------------------------------------------------
 ///
 /// FastQueue section End
@@ -238,13 +532,295 @@ int main() {
     gCounter = 0;
     gActiveConsumer = 0;
 
+    ///
+    /// DeaodSPSC batch test ->
+    ///
+
     // Create the queue
+    auto deaodSPSCBatch = new deaod::spsc_queue<MyObject*, QUEUE_MASK, 6>();
 
-    auto lObject = std::make_unique<int>(8);
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([deaodSPSCBatch] { deaodSPSCBatchConsumer(deaodSPSCBatch, CONSUMER_CPU); }).detach();
+    std::thread([deaodSPSCBatch] { deaodSPSCBatchProducer(deaodSPSCBatch, PRODUCER_CPU); }).detach();
 
-    //auto lFastQueueTest = new FastQueue<std::unique_ptr<int>, QUEUE_MASK, L1_CACHE_LINE>();
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-    //std::cout << std::cref(lFastQueueTest) << std::endl;
+    // Start the test
+    std::cout << "DeaodSPSC batch pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "DeaodSPSC batch pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete deaodSPSCBatch;
+
+    // Print the result.
+    std::cout << "DeaodSPSC batch Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueue batch test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueBatch = new FastQueue<MyObject*, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueBatch] { return fastQueueBatchConsumer(lFastQueueBatch, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueBatch] { return fastQueueBatchProducer(lFastQueueBatch, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueue batch pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueue batch pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueBatch;
+
+    // Print the result.
+    std::cout << "FastQueue batch Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueue value test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueValue = new FastQueueValue();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueValue] { return fastQueueValueConsumer(lFastQueueValue, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueValue] { return fastQueueValueProducer(lFastQueueValue, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueue value test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueue value test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueValue;
+
+    // Print the result.
+    std::cout << "FastQueue value Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueInline test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueInline = new FastQueueInline<MyPayload, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueInline] { return fastQueueInlineConsumer(lFastQueueInline, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueInline] { return fastQueueInlineProducer(lFastQueueInline, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueueInline " << sizeof(MyPayload) << " byte object test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueInline " << sizeof(MyPayload) << " byte object test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueInline;
+
+    // Print the result.
+    std::cout << "FastQueueInline Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueuePool test ->
+    ///
+
+    // Create the pool (same object and queue size as the FastQueue pointer test but no new/delete per object)
+    auto lFastQueuePool = new FastQueuePool<MyObject, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueuePool] { return fastQueuePoolConsumer(lFastQueuePool, CONSUMER_CPU); }).detach();
+    std::thread lPoolProducer([lFastQueuePool] { return fastQueuePoolProducer(lFastQueuePool, PRODUCER_CPU); });
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueuePool pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueuePool pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // The producer may still be in stopQueue() when the consumer is done
+    lPoolProducer.join();
+
+    // Garbage collect the pool
+    delete lFastQueuePool;
+
+    // Print the result.
+    std::cout << "FastQueuePool Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueue deferred clear test ->
+    ///
+
+    // Create the queue (same as the FastQueue pointer test, the consumer empties the slots 8 at a time)
+    auto lFastQueueDeferred = new FastQueueDeferred();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueDeferred] { return fastQueueConsumer(lFastQueueDeferred, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueDeferred] { return fastQueueProducer(lFastQueueDeferred, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueue deferred clear test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueue deferred clear test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueDeferred;
+
+    // Print the result.
+    std::cout << "FastQueue deferred clear Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueue unique_ptr test ->
+    ///
+
+    // Create the queue (objects left in it when it is deleted are deleted by the queue)
+    auto lFastQueueUnique = new FastQueue<std::unique_ptr<MyObject>, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueUnique] { return fastQueueUniqueConsumer(lFastQueueUnique, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueUnique] { return fastQueueUniqueProducer(lFastQueueUnique, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueue unique_ptr test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueue unique_ptr test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueUnique;
+
+    // Print the result.
+    std::cout << "FastQueue unique_ptr Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
 
     return 0;
 }
@@ -0,0 +1,135 @@
+//
+// Hardware performance counters for the benchmarks
+//
+
+// PerfCounters counts the events of the thread that created it between start() and stop(). On Linux the counters
+// are perf_event_open() user space counters (needs perf_event_paranoid <= 2 or CAP_PERFMON). A counter the kernel or
+// the CPU does not support is left out and reported as not valid, so the benchmark runs without counters in a VM or
+// container. The HITM / snoop events are CPU model specific and are passed as a raw event config, for example
+// MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM is 0x4d2 on Skylake (see the perf list / Intel / AMD event tables).
+// Other OS's report the counters as not valid (kperf on macOS is a private framework that needs root).
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <array>
+
+enum PerfCounter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_L1D_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_TASK_CLOCK,
+    PERF_RAW,
+    PERF_COUNTERS
+};
+
+static const char* const PERF_COUNTER_NAMES[PERF_COUNTERS] = {
+        "cycles", "instructions", "cache-misses", "l1d-misses", "branch-misses", "task-clock-ns", "raw"
+};
+
+struct PerfCounterValues {
+    std::array<uint64_t, PERF_COUNTERS> mValues{};
+    std::array<bool, PERF_COUNTERS> mValid{};
+};
+
+#if defined __linux
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+class PerfCounters {
+public:
+    //aRawConfig 0 leaves the raw counter out
+    explicit PerfCounters(uint64_t aRawConfig = 0) {
+        mFds.fill(-1);
+        mFds[PERF_CYCLES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        mFds[PERF_INSTRUCTIONS] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        mFds[PERF_CACHE_MISSES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        mFds[PERF_L1D_MISSES] = open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                     (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        mFds[PERF_BRANCH_MISSES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        mFds[PERF_TASK_CLOCK] = open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+        if (aRawConfig) {
+            mFds[PERF_RAW] = open(PERF_TYPE_RAW, aRawConfig);
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+        for (int lFd: mFds) {
+            if (lFd >= 0) {
+                close(lFd);
+            }
+        }
+    }
+
+    void start() noexcept {
+        for (int lFd: mFds) {
+            if (lFd >= 0) {
+                ioctl(lFd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(lFd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    void stop() noexcept {
+        for (int lFd: mFds) {
+            if (lFd >= 0) {
+                ioctl(lFd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+    }
+
+    //Scaled up if the kernel multiplexed a counter (more events than hardware counters)
+    PerfCounterValues read() const noexcept {
+        PerfCounterValues lValues;
+        for (uint64_t i = 0; i < PERF_COUNTERS; ++i) {
+            //value, time enabled, time running
+            uint64_t lRead[3] = {};
+            if (mFds[i] < 0 || ::read(mFds[i], lRead, sizeof(lRead)) != sizeof(lRead) || !lRead[2]) {
+                continue;
+            }
+            lValues.mValues[i] = lRead[2] < lRead[1] ?
+                    static_cast<uint64_t>(static_cast<double>(lRead[0]) * lRead[1] / lRead[2]) : lRead[0];
+            lValues.mValid[i] = true;
+        }
+        return lValues;
+    }
+
+private:
+    //This thread, any CPU, user space only. -1 if the event is not supported.
+    static int open(uint32_t aType, uint64_t aConfig) noexcept {
+        perf_event_attr lAttr;
+        std::memset(&lAttr, 0, sizeof(lAttr));
+        lAttr.size = sizeof(lAttr);
+        lAttr.type = aType;
+        lAttr.config = aConfig;
+        lAttr.disabled = 1;
+        lAttr.exclude_kernel = 1;
+        lAttr.exclude_hv = 1;
+        lAttr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &lAttr, 0, -1, -1, 0));
+    }
+
+    std::array<int, PERF_COUNTERS> mFds{};
+};
+
+#else
+
+class PerfCounters {
+public:
+    explicit PerfCounters(uint64_t = 0) {}
+    void start() noexcept {}
+    void stop() noexcept {}
+    PerfCounterValues read() const noexcept {
+        return {};
+    }
+};
+
+#endif
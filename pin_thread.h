@@ -4,12 +4,42 @@
 
 #pragma once
 
+#include <cstdint>
+
+//How close two CPU's are, the closest shared level. cpuRelation() reads it from the OS topology.
+enum class CpuRelation {
+    Unknown,
+    SameCpu,
+    //Hyper-threads / SMT threads of one core
+    SmtSibling,
+    //Different cores sharing an L2 (Apple / ARM clusters, Intel E-core modules)
+    SameCluster,
+    //Different clusters sharing the last level cache (an AMD CCX, an Intel die)
+    SameLlc,
+    //Same package without a shared cache (AMD CCD to CCD), or different clusters on Apple silicon
+    CrossDie,
+    CrossSocket
+};
+
+inline const char* cpuRelationName(CpuRelation aRelation) {
+    switch (aRelation) {
+        case CpuRelation::SameCpu: return "same-cpu";
+        case CpuRelation::SmtSibling: return "smt-sibling";
+        case CpuRelation::SameCluster: return "same-cluster";
+        case CpuRelation::SameLlc: return "same-llc";
+        case CpuRelation::CrossDie: return "cross-die";
+        case CpuRelation::CrossSocket: return "cross-socket";
+        default: return "unknown";
+    }
+}
+
 #ifdef __APPLE__
     #include <TargetConditionals.h>
     #ifdef TARGET_OS_MAC
 
 #include <sys/types.h>
 #include <sys/sysctl.h>
+#include <string>
 #import <mach/thread_act.h>
 
 #define SYSCTL_CORE_COUNT   "machdep.cpu.core_count"
@@ -27,7 +57,7 @@ CPU_SET(int num, cpu_set_t *cs) { cs->count |= (1 << num); }
 static inline int
 CPU_ISSET(int num, cpu_set_t *cs) { return (cs->count & (1 << num)); }
 
-bool raise_thread_priority() {
+inline bool raise_thread_priority() {
     /* raise the thread's priority */
     thread_extended_policy_data_t extendedPolicy;
     thread_act_t this_thread = pthread_mach_thread_np(pthread_self());
@@ -43,7 +73,8 @@ bool raise_thread_priority() {
     return true;
 }
 
-int sched_getaffinity(pid_t pid, size_t cpu_size, cpu_set_t *cpu_set)
+//static like the CPU_ helpers, every translation unit including pin_thread.h gets its own copy
+static inline int sched_getaffinity(pid_t pid, size_t cpu_size, cpu_set_t *cpu_set)
 {
     int32_t core_count = 0;
     size_t  len = sizeof(core_count);
@@ -58,8 +89,8 @@ int sched_getaffinity(pid_t pid, size_t cpu_size, cpu_set_t *cpu_set)
     return 0;
 }
 
-int pthread_setaffinity_np(pthread_t thread, size_t cpu_size,
-                           cpu_set_t *cpu_set) {
+static inline int pthread_setaffinity_np(pthread_t thread, size_t cpu_size,
+                                         cpu_set_t *cpu_set) {
     thread_port_t mach_thread;
     int core = 0;
 
@@ -73,7 +104,7 @@ int pthread_setaffinity_np(pthread_t thread, size_t cpu_size,
     return 0;
 }
 
-bool pinThread(int32_t aCpu) {
+inline bool pinThread(int32_t aCpu) {
     if (aCpu < 0) {
         return false;
     }
@@ -87,6 +118,54 @@ bool pinThread(int32_t aCpu) {
     return true;
 }
 
+//Apple silicon / Intel Macs are a single memory node
+inline int32_t cpuNumaNode(int32_t aCpu) {
+    return aCpu < 0 ? -1 : 0;
+}
+
+//The L2 cluster of aCpu from the hw.perflevelN sysctl's, -1 if unknown. The CPU's are numbered from the efficiency
+//cores (the highest perflevel) up to the performance cores (perflevel0), cpusperl2 of them share an L2.
+inline int32_t cpuCluster(int32_t aCpu) {
+    int32_t lLevels = 0;
+    size_t lLength = sizeof(lLevels);
+    if (aCpu < 0 || sysctlbyname("hw.nperflevels", &lLevels, &lLength, nullptr, 0) || lLevels <= 0) {
+        return -1;
+    }
+    int32_t lFirstCpu = 0;
+    int32_t lFirstCluster = 0;
+    for (int32_t lLevel = lLevels - 1; lLevel >= 0; --lLevel) {
+        int32_t lCpus = 0;
+        int32_t lCpusPerL2 = 0;
+        std::string lPrefix = "hw.perflevel" + std::to_string(lLevel);
+        lLength = sizeof(lCpus);
+        if (sysctlbyname((lPrefix + ".logicalcpu").c_str(), &lCpus, &lLength, nullptr, 0)) {
+            return -1;
+        }
+        lLength = sizeof(lCpusPerL2);
+        if (sysctlbyname((lPrefix + ".cpusperl2").c_str(), &lCpusPerL2, &lLength, nullptr, 0) || lCpusPerL2 <= 0) {
+            lCpusPerL2 = lCpus;
+        }
+        if (aCpu < lFirstCpu + lCpus) {
+            return lFirstCluster + (aCpu - lFirstCpu) / lCpusPerL2;
+        }
+        lFirstCpu += lCpus;
+        lFirstCluster += (lCpus + lCpusPerL2 - 1) / lCpusPerL2;
+    }
+    return -1;
+}
+
+inline CpuRelation cpuRelation(int32_t aCpuA, int32_t aCpuB) {
+    int32_t lClusterA = cpuCluster(aCpuA);
+    int32_t lClusterB = cpuCluster(aCpuB);
+    if (lClusterA < 0 || lClusterB < 0) {
+        return CpuRelation::Unknown;
+    }
+    if (aCpuA == aCpuB) {
+        return CpuRelation::SameCpu;
+    }
+    return lClusterA == lClusterB ? CpuRelation::SameCluster : CpuRelation::CrossDie;
+}
+
 
 
     #else
@@ -94,7 +173,8 @@ bool pinThread(int32_t aCpu) {
     #endif
 #elif defined _WIN64
 #include <Windows.h>
-bool pinThread(int32_t aCpu) {
+#include <vector>
+inline bool pinThread(int32_t aCpu) {
     if (aCpu > 64) {
         throw std::runtime_error("Support for more than 64 CPU's under Windows is not implemented.");
     }
@@ -106,8 +186,72 @@ bool pinThread(int32_t aCpu) {
     }
     return false;
 }
+
+//The NUMA node of aCpu, -1 if unknown
+inline int32_t cpuNumaNode(int32_t aCpu) {
+    UCHAR lNode = 0;
+    if (aCpu < 0 || aCpu > 255 || !GetNumaProcessorNode(static_cast<UCHAR>(aCpu), &lNode) || lNode == 0xFF) {
+        return -1;
+    }
+    return lNode;
+}
+
+//From GetLogicalProcessorInformationEx, processor group 0 only (like pinThread())
+inline CpuRelation cpuRelation(int32_t aCpuA, int32_t aCpuB) {
+    if (aCpuA < 0 || aCpuB < 0 || aCpuA > 63 || aCpuB > 63) {
+        return CpuRelation::Unknown;
+    }
+    DWORD lLength = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &lLength);
+    std::vector<uint8_t> lBuffer(lLength);
+    if (!lLength || !GetLogicalProcessorInformationEx(RelationAll,
+            reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(lBuffer.data()), &lLength)) {
+        return CpuRelation::Unknown;
+    }
+    const KAFFINITY lA = 1ULL << aCpuA;
+    const KAFFINITY lBoth = lA | (1ULL << aCpuB);
+    bool lKnown = false, lCoreShared = false, lL2 = false, lL3 = false, lPackage = false;
+    for (DWORD lOffset = 0; lOffset < lLength;) {
+        auto lpInfo = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(lBuffer.data() + lOffset);
+        if (lpInfo->Relationship == RelationProcessorCore || lpInfo->Relationship == RelationProcessorPackage) {
+            KAFFINITY lMask = lpInfo->Processor.GroupMask[0].Group == 0 ? lpInfo->Processor.GroupMask[0].Mask : 0;
+            bool lIsCore = lpInfo->Relationship == RelationProcessorCore;
+            lKnown |= lIsCore && (lMask & lA);
+            if ((lMask & lBoth) == lBoth) {
+                (lIsCore ? lCoreShared : lPackage) = true;
+            }
+        } else if (lpInfo->Relationship == RelationCache && lpInfo->Cache.GroupMask.Group == 0 &&
+                   (lpInfo->Cache.GroupMask.Mask & lBoth) == lBoth) {
+            lL2 |= lpInfo->Cache.Level == 2;
+            lL3 |= lpInfo->Cache.Level == 3;
+        }
+        lOffset += lpInfo->Size;
+    }
+    if (!lKnown) {
+        return CpuRelation::Unknown;
+    }
+    if (aCpuA == aCpuB) {
+        return CpuRelation::SameCpu;
+    }
+    if (lCoreShared) {
+        return CpuRelation::SmtSibling;
+    }
+    if (lL2) {
+        return CpuRelation::SameCluster;
+    }
+    if (lL3) {
+        return CpuRelation::SameLlc;
+    }
+    return lPackage ? CpuRelation::CrossDie : CpuRelation::CrossSocket;
+}
 #elif  __linux
-bool pinThread(int32_t aCpu) {
+#include <dirent.h>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <fstream>
+
+inline bool pinThread(int32_t aCpu) {
     if (aCpu < 0) {
         return false;
     }
@@ -119,6 +263,90 @@ bool pinThread(int32_t aCpu) {
     }
     return true;
 }
+
+//The NUMA node of aCpu (the nodeN link in sysfs), -1 if the CPU does not exist
+inline int32_t cpuNumaNode(int32_t aCpu) {
+    if (aCpu < 0) {
+        return -1;
+    }
+    std::string lPath = "/sys/devices/system/cpu/cpu" + std::to_string(aCpu);
+    DIR* lpDir = opendir(lPath.c_str());
+    if (!lpDir) {
+        return -1;
+    }
+    //A kernel without NUMA support has no node links, everything is node 0
+    int32_t lNode = 0;
+    while (dirent* lpEntry = readdir(lpDir)) {
+        if (std::strncmp(lpEntry->d_name, "node", 4) == 0) {
+            lNode = std::atoi(lpEntry->d_name + 4);
+            break;
+        }
+    }
+    closedir(lpDir);
+    return lNode;
+}
+
+//The number in the sysfs file rPath, -1 if it does not exist
+inline int32_t readSysfsNumber(const std::string& rPath) {
+    std::ifstream lFile(rPath);
+    int32_t lNumber = -1;
+    if (!(lFile >> lNumber)) {
+        return -1;
+    }
+    return lNumber;
+}
+
+//True if the sysfs CPU list in rPath ("0-3,8,10-11") holds aCpu
+inline bool sysfsCpuListContains(const std::string& rPath, int32_t aCpu) {
+    std::ifstream lFile(rPath);
+    std::string lRange;
+    while (std::getline(lFile, lRange, ',')) {
+        size_t lDash = lRange.find('-');
+        int32_t lFirst = std::atoi(lRange.c_str());
+        int32_t lLast = lDash == std::string::npos ? lFirst : std::atoi(lRange.c_str() + lDash + 1);
+        if (aCpu >= lFirst && aCpu <= lLast) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//From /sys/devices/system/cpu/cpuN/topology and the cache/indexN shared_cpu_list's
+inline CpuRelation cpuRelation(int32_t aCpuA, int32_t aCpuB) {
+    if (aCpuA < 0 || aCpuB < 0) {
+        return CpuRelation::Unknown;
+    }
+    std::string lPathA = "/sys/devices/system/cpu/cpu" + std::to_string(aCpuA);
+    int32_t lPackageA = readSysfsNumber(lPathA + "/topology/physical_package_id");
+    int32_t lPackageB = readSysfsNumber("/sys/devices/system/cpu/cpu" + std::to_string(aCpuB) + "/topology/physical_package_id");
+    if (lPackageA < 0 || lPackageB < 0) {
+        return CpuRelation::Unknown;
+    }
+    if (aCpuA == aCpuB) {
+        return CpuRelation::SameCpu;
+    }
+    if (sysfsCpuListContains(lPathA + "/topology/thread_siblings_list", aCpuB)) {
+        return CpuRelation::SmtSibling;
+    }
+    int32_t lSharedLevel = 0;
+    for (int32_t lIndex = 0;; ++lIndex) {
+        std::string lCachePath = lPathA + "/cache/index" + std::to_string(lIndex);
+        int32_t lLevel = readSysfsNumber(lCachePath + "/level");
+        if (lLevel < 0) {
+            break;
+        }
+        if (sysfsCpuListContains(lCachePath + "/shared_cpu_list", aCpuB) && (!lSharedLevel || lLevel < lSharedLevel)) {
+            lSharedLevel = lLevel;
+        }
+    }
+    if (lSharedLevel && lSharedLevel <= 2) {
+        return CpuRelation::SameCluster;
+    }
+    if (lSharedLevel) {
+        return CpuRelation::SameLlc;
+    }
+    return lPackageA == lPackageB ? CpuRelation::CrossDie : CpuRelation::CrossSocket;
+}
 #else
 #error OS not supported
 #endif